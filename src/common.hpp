@@ -11,7 +11,9 @@
 #define COMMON_H
 
 #include <cstdint>
+#include <atomic>
 
+#include "benchmark.hpp"
 #include "host.hpp"
 #include "hud.hpp"
 #include "machine.hpp"
@@ -24,13 +26,15 @@
 #define E64_YEAR             2021
 
 /* Global objects */
+extern E64::benchmark_t	benchmark;
 extern E64::host_t	host;
 extern E64::hud_t	hud;
 extern E64::machine_t	machine;
 extern E64::stats_t	stats;
 extern E64::vicv_ic	vicv;
 
-extern bool		app_running;
+/* Set to false from any thread to end the application */
+extern std::atomic<bool> app_running;
 
 #define	RAM_SIZE	0x010000
 
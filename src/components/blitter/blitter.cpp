@@ -3,6 +3,11 @@
 //
 //  Copyright © 2020-2021 elmerucr. All rights reserved.
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
 #include "blitter.hpp"
 #include "rom.hpp"
 #include "common.hpp"
@@ -12,15 +17,35 @@ E64::blitter_ic::blitter_ic()
 	fb0 = new uint16_t[VICV_PIXELS_PER_SCANLINE * VICV_SCANLINES];
 	fb1 = new uint16_t[VICV_PIXELS_PER_SCANLINE * VICV_SCANLINES];
 	
-	blit_memory = new uint8_t[256 * 65536];	// 16mb
+	/*
+	 * 16mb of anonymous memory. The system only provides pages once
+	 * they're touched, and slices get their initial pattern on first
+	 * use (see touch_slice).
+	 */
+	blit_memory = (uint8_t *)mmap(nullptr, 256 * 65536, PROT_READ | PROT_WRITE,
+				      MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (blit_memory == MAP_FAILED) {
+		printf("[blitter] error: can't map blit memory\n");
+		abort();
+	}
+	for (int i=0; i<256; i++) slice_filled[i] = false;
 	
-	// fill blit memory with something
-	for (int i=0; i < (256 * 65536); i++) {
-		if (i & 0b1) {
-			blit_memory[i] = (i & 0xff0000) >> 16;
-		} else {
-			blit_memory[i] = (i & 0x00ff00) >> 8;
-		}
+	workers_running = 0;
+	worker_generation = 0;
+	workers_quit = false;
+	
+	batch = 0;
+	
+	for (int i=0; i<256; i++) {
+		surfaces[i].pixels = nullptr;
+		surfaces[i].size = 0;
+		surfaces[i].tile_data = nullptr;
+		surfaces[i].tile_color_data = nullptr;
+		surfaces[i].tile_background_color_data = nullptr;
+		surfaces[i].drawn = false;
+		surfaces[i].rasterised = false;
+		surfaces[i].batch = 0;
+		memory_generation[i] = 0;
 	}
 	
 	blit = new struct blit_t[256];
@@ -54,9 +79,17 @@ E64::blitter_ic::blitter_ic()
 
 E64::blitter_ic::~blitter_ic()
 {
+	stop_workers();
+	
+	for (int i=0; i<256; i++) {
+		delete [] surfaces[i].tile_background_color_data;
+		delete [] surfaces[i].tile_color_data;
+		delete [] surfaces[i].tile_data;
+		delete [] surfaces[i].pixels;
+	}
 	delete [] cbm_font;
 	delete [] blit;
-	delete [] blit_memory;
+	munmap(blit_memory, 256 * 65536);
 	
 	delete [] fb1;
 	delete [] fb0;
@@ -66,6 +99,8 @@ E64::blitter_ic::~blitter_ic()
 void E64::blitter_ic::reset()
 {
 	blitter_state = IDLE;
+	jobs.clear();
+	job_queued = false;
 
 	head = 0;
 	tail = 0;
@@ -77,6 +112,15 @@ void E64::blitter_ic::reset()
 	
 	frontbuffer = fb0;
 	backbuffer  = fb1;
+	front_transparent = false;
+	back_transparent = false;
+}
+
+void E64::blitter_ic::fill_slice(uint8_t slice)
+{
+	uint8_t *memory = &blit_memory[slice << 16];
+	for (int i=0; i < 65536; i++) memory[i] = fill_pattern((slice << 16) | i);
+	slice_filled[slice] = true;
 }
 
 inline void E64::blitter_ic::check_new_operation()
@@ -89,6 +133,9 @@ inline void E64::blitter_ic::check_new_operation()
 				height_on_screen = VICV_SCANLINES;
 				total_no_of_pix = (width_on_screen * height_on_screen);
 				pixel_no = 0;
+				job.type = CLEARING;
+				job_queued = false;
+				clear_transparent = true;
 				tail++;
 				break;
 			case BORDER:
@@ -97,6 +144,8 @@ inline void E64::blitter_ic::check_new_operation()
 				height_on_screen = border_size;
 				total_no_of_pix = (width_on_screen * height_on_screen);
 				pixel_no = 0;
+				job.type = DRAW_BORDER;
+				job_queued = false;
 				tail++;
 				break;
 			case BLIT:
@@ -132,6 +181,46 @@ inline void E64::blitter_ic::check_new_operation()
 		    
 				width_mask = width - 1;
 				width_on_screen_mask = width_on_screen - 1;
+				
+				/*
+				 * Clipping, done once per blit. Only the rows and
+				 * columns found here are visited, the others are
+				 * just charged for.
+				 */
+				{
+					int32_t first, end;
+					if (hor_flip) {
+						// scrn_x = x + width_on_screen - 1 - column
+						first = operations[tail].x_pos + width_on_screen - VICV_PIXELS_PER_SCANLINE;
+						end = operations[tail].x_pos + width_on_screen;
+					} else {
+						// scrn_x = x + column
+						first = -operations[tail].x_pos;
+						end = VICV_PIXELS_PER_SCANLINE - operations[tail].x_pos;
+					}
+					if (first < 0) first = 0;
+					if (end > width_on_screen) end = width_on_screen;
+					if (end < first) end = first;
+					first_visible_column = first;
+					end_visible_column = end;
+					
+					if (ver_flip) {
+						// scrn_y = y + height_on_screen - 1 - row
+						first = operations[tail].y_pos + height_on_screen - VICV_SCANLINES;
+						end = operations[tail].y_pos + height_on_screen;
+					} else {
+						// scrn_y = y + row
+						first = -operations[tail].y_pos;
+						end = VICV_SCANLINES - operations[tail].y_pos;
+					}
+					if (first < 0) first = 0;
+					if (end > height_on_screen) end = height_on_screen;
+					if (end < first) end = first;
+					
+					visible = (first_visible_column < end_visible_column) &&
+						(first < end);
+				}
+				
 				pixel_no = 0;
 				total_no_of_pix = width_on_screen * height_on_screen;
 				x = operations[tail].x_pos;
@@ -142,6 +231,45 @@ inline void E64::blitter_ic::check_new_operation()
 				tile_data = operations[tail].blit_pointer->tile_data;
 				tile_color_data = operations[tail].blit_pointer->tile_color_data;
 				tile_background_color_data = operations[tail].blit_pointer->tile_background_color_data;
+				
+				/* everything the span engine needs for this blit */
+				job.type = BLITTING;
+				job.kernel =
+					(bitmap_mode     ? 0b000001 : 0) |
+					(multicolor_mode ? 0b000010 : 0) |
+					(background      ? 0b000100 : 0) |
+					(color_per_tile  ? 0b001000 : 0) |
+					(hor_flip        ? 0b010000 : 0) |
+					(double_width    ? 0b100000 : 0);
+				job.source = use_cbm_font ? cbm_font : pixel_data;
+				job.tile_data = tile_data;
+				job.tile_color_data = tile_color_data;
+				job.tile_background_color_data = tile_background_color_data;
+				job.x = x;
+				job.y = y;
+				job.hor_flip = hor_flip;
+				job.ver_flip = ver_flip;
+				job.double_width = double_width;
+				job.double_height = double_height;
+				job.width_log2 = width_log2;
+				job.height_log2 = height_log2;
+				job.width_in_tiles_log2 = width_in_tiles_log2;
+				job.width_on_screen_log2 = width_on_screen_log2;
+				job.width_on_screen_mask = width_on_screen_mask;
+				job.width_on_screen = width_on_screen;
+				job.height_on_screen = height_on_screen;
+				job.foreground_color = foreground_color;
+				job.background_color = background_color;
+				job.first_visible_column = first_visible_column;
+				job.end_visible_column = end_visible_column;
+				if ((operations[tail].blit_pointer >= blit) &&
+				    (operations[tail].blit_pointer < &blit[256])) {
+					job.blit_no = operations[tail].blit_pointer - blit;
+					touch_slice(job.blit_no);
+				} else {
+					job.blit_no = 256;	// not one of ours, no surface
+				}
+				job_queued = false;
 				tail++;
 				break;
 		}
@@ -150,108 +278,453 @@ inline void E64::blitter_ic::check_new_operation()
 
 void E64::blitter_ic::run(int no_of_cycles)
 {
-	while (no_of_cycles > 0) {
-		no_of_cycles--;
+	advance(no_of_cycles);
+	do_jobs();
+}
 
+void E64::blitter_ic::flush()
+{
+	do advance(1000); while (busy());
+	do_jobs();
+}
+
+void E64::blitter_ic::advance(int no_of_cycles)
+{
+	while (no_of_cycles > 0) {
 		switch (blitter_state) {
 		case IDLE:
+			no_of_cycles--;
 			check_new_operation();
+			/*
+			 * Operations are only added from outside, so nothing
+			 * will happen during the remaining cycles.
+			 */
+			if (blitter_state == IDLE) return;
 			break;
 		case CLEARING:
+		case DRAW_BORDER:
+		case BLITTING:
 			if (!(pixel_no == total_no_of_pix)) {
-				backbuffer[pixel_no] = clear_color;
-				pixel_no++;
+				/*
+				 * One cycle per pixel, whether it is visible
+				 * or not, but all pixels the cycles allow for
+				 * are handed out in one go.
+				 */
+				uint32_t pixels = total_no_of_pix - pixel_no;
+				if (pixels > (uint32_t)no_of_cycles) pixels = no_of_cycles;
+				if ((blitter_state != BLITTING) || visible)
+					queue_job(pixel_no, pixel_no + pixels);
+				pixel_no += pixels;
+				no_of_cycles -= pixels;
 			} else {
+				no_of_cycles--;
+				if ((blitter_state == CLEARING) && clear_transparent)
+					back_transparent = true;
 				blitter_state = IDLE;
 			}
 			break;
-		case DRAW_BORDER:
-			if (!(pixel_no == total_no_of_pix)) {
-				alpha_blend(&backbuffer[pixel_no], &border_color);
-				alpha_blend(&backbuffer[(VICV_TOTAL_PIXELS-1) - pixel_no], &border_color);
-				pixel_no++;
-			} else {
-				blitter_state = IDLE;
+		}
+	}
+}
+
+inline void E64::blitter_ic::queue_job(uint32_t start, uint32_t end)
+{
+	if (job_queued) {
+		/* continuation of the same operation */
+		jobs.back().end = end;
+	} else {
+		job.start = start;
+		job.end = end;
+		/*
+		 * Clear and border color registers may change while an
+		 * operation is in progress, so take them per run.
+		 */
+		job.color = (job.type == CLEARING) ? clear_color : border_color;
+		if ((job.type != CLEARING) || (job.color & 0xf000)) {
+			back_transparent = false;
+			clear_transparent = false;
+		}
+		job.surface = (job.type == BLITTING) ? retained_surface(job) : nullptr;
+		jobs.push_back(job);
+		job_queued = true;
+	}
+}
+
+/*
+ * Retained surfaces. A blit is rasterised into the surface of its
+ * descriptor (unflipped and not stretched) once it is drawn twice in a
+ * row with the same contents. After that, drawing it is just a blend from
+ * the surface, until its contents change.
+ *
+ * Contents are the descriptor fields, the tile, color and background
+ * color data (compared against a copy, as the hud rewrites these every
+ * frame, mostly with the same values) and the pixel data, which is
+ * tracked by a generation count per 64k slice of blit memory.
+ */
+const uint16_t *E64::blitter_ic::retained_surface(const job_t &job)
+{
+	if (job.blit_no >= 256) return nullptr;
+	
+	surface_t *surface = &surfaces[job.blit_no];
+	uint8_t kernel = job.kernel & 0b001111;		// no flip or stretch
+	bool bitmap = kernel & 0b000001;
+	bool tile_colors = kernel & 0b001000;
+	
+	uint32_t no_of_pixels = 1 << (job.width_log2 + job.height_log2);
+	uint32_t no_of_tiles = no_of_pixels >> 6;
+	uint32_t no_of_colors = std::min(no_of_tiles, (uint32_t)0x800);
+	
+	bool unchanged =
+		surface->drawn &&
+		(surface->kernel == kernel) &&
+		(surface->source == job.source) &&
+		(surface->width_log2 == job.width_log2) &&
+		(surface->height_log2 == job.height_log2) &&
+		(surface->foreground_color == job.foreground_color) &&
+		(surface->background_color == job.background_color) &&
+		(surface->generation == memory_generation[job.blit_no]);
+	
+	if (unchanged && !bitmap) {
+		unchanged = !memcmp(surface->tile_data, job.tile_data, no_of_tiles);
+		if (unchanged && tile_colors) {
+			unchanged = !memcmp(surface->tile_color_data, job.tile_color_data,
+					    no_of_colors * sizeof(uint16_t)) &&
+				!memcmp(surface->tile_background_color_data,
+					job.tile_background_color_data,
+					no_of_colors * sizeof(uint16_t));
+		}
+	}
+	
+	if (unchanged) {
+		if (!surface->rasterised) {
+			job_t unstretched = job;
+			unstretched.double_height = 0;
+			for (uint16_t row = 0; row < (1 << job.height_log2); row++) {
+				(this->*row_kernels[kernel])(unstretched, row, 0, 1 << job.width_log2,
+							     &surface->pixels[row << job.width_log2]);
 			}
+			surface->rasterised = true;
+		}
+		surface->batch = batch;
+		return surface->pixels;
+	}
+	
+	/* queued jobs may still need the old pixels */
+	if (surface->rasterised && (surface->batch == batch)) do_jobs();
+	
+	/* remember what was drawn, it might be the same next time */
+	if (surface->size < no_of_pixels) {
+		delete [] surface->pixels;
+		surface->pixels = new uint16_t[no_of_pixels];
+		surface->size = no_of_pixels;
+	}
+	if (!surface->tile_data) {
+		surface->tile_data = new uint8_t[128 * 128];
+		surface->tile_color_data = new uint16_t[0x800];
+		surface->tile_background_color_data = new uint16_t[0x800];
+	}
+	surface->drawn = true;
+	surface->rasterised = false;
+	surface->kernel = kernel;
+	surface->source = job.source;
+	surface->width_log2 = job.width_log2;
+	surface->height_log2 = job.height_log2;
+	surface->foreground_color = job.foreground_color;
+	surface->background_color = job.background_color;
+	surface->generation = memory_generation[job.blit_no];
+	if (!bitmap) {
+		memcpy(surface->tile_data, job.tile_data, no_of_tiles);
+		if (tile_colors) {
+			memcpy(surface->tile_color_data, job.tile_color_data,
+			       no_of_colors * sizeof(uint16_t));
+			memcpy(surface->tile_background_color_data,
+			       job.tile_background_color_data,
+			       no_of_colors * sizeof(uint16_t));
+		}
+	}
+	return nullptr;
+}
+
+void E64::blitter_ic::do_jobs()
+{
+	if (jobs.empty()) return;
+	
+	if (workers.empty()) {
+		do_band(0);
+	} else {
+		{
+			std::lock_guard<std::mutex> lock(worker_mutex);
+			workers_running = (int)workers.size();
+			worker_generation++;
+		}
+		worker_wake.notify_all();
+		do_band(0);
+		std::unique_lock<std::mutex> lock(worker_mutex);
+		worker_done.wait(lock, [this] { return workers_running == 0; });
+	}
+	
+	jobs.clear();
+	job_queued = false;
+	batch++;
+}
+
+/*
+ * Band b of n covers scanlines (b * VICV_SCANLINES / n) up to
+ * ((b + 1) * VICV_SCANLINES / n). All jobs are done in order, clipped to
+ * the band. Every pixel belongs to exactly one band, so the outcome is
+ * the same as doing everything on one thread.
+ */
+void E64::blitter_ic::do_band(int band)
+{
+	int no_of_bands = (int)workers.size() + 1;
+	uint16_t first_scanline = (band * VICV_SCANLINES) / no_of_bands;
+	uint16_t end_scanline = ((band + 1) * VICV_SCANLINES) / no_of_bands;
+	
+	uint32_t band_start = first_scanline * VICV_PIXELS_PER_SCANLINE;
+	uint32_t band_end = end_scanline * VICV_PIXELS_PER_SCANLINE;
+	
+	for (const job_t &j : jobs) {
+		uint32_t start = std::max(j.start, band_start);
+		uint32_t end = std::min(j.end, band_end);
+		
+		switch (j.type) {
+		case CLEARING:
+			if (start < end)
+				std::fill_n(&backbuffer[start], end - start, j.color);
+			break;
+		case DRAW_BORDER:
+			/* top rows, and mirrored bottom rows */
+			if (start < end)
+				alpha_blend_color(&backbuffer[start], j.color, end - start);
+			start = std::max(VICV_TOTAL_PIXELS - j.end, band_start);
+			end = std::min(VICV_TOTAL_PIXELS - j.start, band_end);
+			if (start < end)
+				alpha_blend_color(&backbuffer[start], j.color, end - start);
 			break;
 		case BLITTING:
-			if (!(pixel_no == total_no_of_pix)) {
-				scrn_x = x + (hor_flip ? (width_on_screen - (pixel_no & width_on_screen_mask) - 1) : (pixel_no & width_on_screen_mask) );
-                    
-				if (scrn_x < VICV_PIXELS_PER_SCANLINE) {        // clipping check horizontally
-					scrn_y = y + (ver_flip ?
-						      (height_on_screen - (pixel_no >> width_on_screen_log2) - 1) : (pixel_no >> width_on_screen_log2) );
-                        
-					if (scrn_y < VICV_SCANLINES) {     // clipping check vertically
-                            /*
-                             * Transformation of pixel_no to take into account double width and/or height. After
-                             * this <complex> transformation, the normalized pixel_no points to a position in the
-                             * source material.
-                             * NEEDS WORK: document this transformation
-                             */
-                            normalized_pixel_no = (((pixel_no >> double_height) & ~width_on_screen_mask) | (pixel_no & width_on_screen_mask)) >> double_width;
-                            
-                            /* Calculate the current x and y positions within the current blit source pixeldata */
-                            x_in_blit = normalized_pixel_no & width_mask;
-                            y_in_blit = normalized_pixel_no >> width_log2;
-                            
-                            tile_x = x_in_blit >> 3;
-                            tile_y = y_in_blit >> 3;
-                            
-                            tile_number = tile_x + (tile_y << width_in_tiles_log2);
-                            
-				tile_index = tile_data[tile_number & 0x7fff];
-                            
-                            /* Replace foreground and background colors if necessary */
-                            if (color_per_tile) {
-				    foreground_color = tile_color_data[tile_number & 0x7ff];
-				    background_color = tile_background_color_data[tile_number & 0x7ff];
-                            }
-                            
-                            pixel_in_tile = (x_in_blit & 0b111) | ((y_in_blit & 0b111) << 3);
-                            
-				/*
-				 * Pick the right pixel depending on bitmap mode or tile mode,
-				 * and based on cbm_font or not
-				 */
-				if (use_cbm_font) {
-					source_color = bitmap_mode ?
-					cbm_font[normalized_pixel_no & 0x3fff] : cbm_font[((tile_index << 6) | pixel_in_tile) & 0x3fff];
-				} else {
-                            source_color = bitmap_mode ?
-				pixel_data[normalized_pixel_no & 0x3fff] : pixel_data[((tile_index << 6) | pixel_in_tile) & 0x3fff];
-				}
-                            
-                            /*
-			     * If the source color has an alpha value of higher than 0x0 (there is a pixel),
-                             * and we're not in multicolor mode, replace with foreground color.
-                             *
-                             * If there's no alpha value (no pixel), and we have background 'on',
-                             * replace the color with background color.
-                             *
-                             * At this stage, we have already checked for color per
-                             * tile, and if so, the value of foreground and respectively
-                             * background color have been replaced accordingly.
-                             */
-                            if (source_color & 0xf000) {
-                                if (!multicolor_mode) source_color = foreground_color;
-                            } else {
-                                if (background) source_color = background_color;
-                            }
-                            
-                            /* Finally, call the alpha blend function */
-                            alpha_blend(&backbuffer[scrn_x + (scrn_y * VICV_PIXELS_PER_SCANLINE)], &source_color);
-                        }
-                    }
-                    pixel_no++;
-                } else {
-                    blitter_state = IDLE;
-                }
-                break;
-        }
-    }
+			blit_span(j, first_scanline, end_scanline);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void E64::blitter_ic::worker(int band, uint32_t generation)
+{
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(worker_mutex);
+			worker_wake.wait(lock, [this, generation] {
+				return workers_quit || (worker_generation != generation);
+			});
+			if (workers_quit) return;
+			generation = worker_generation;
+		}
+		
+		do_band(band);
+		
+		std::lock_guard<std::mutex> lock(worker_mutex);
+		if (--workers_running == 0) worker_done.notify_one();
+	}
+}
+
+void E64::blitter_ic::stop_workers()
+{
+	{
+		std::lock_guard<std::mutex> lock(worker_mutex);
+		workers_quit = true;
+	}
+	worker_wake.notify_all();
+	for (std::thread &t : workers) t.join();
+	workers.clear();
+	workers_quit = false;
+}
+
+void E64::blitter_ic::set_threads(int no_of_threads)
+{
+	if (no_of_threads < 1) no_of_threads = 1;
+	if (no_of_threads > BLITTER_MAX_THREADS) no_of_threads = BLITTER_MAX_THREADS;
+	
+	stop_workers();
+	
+	/*
+	 * Resolve the blend kernels on this thread, before any worker
+	 * can call them.
+	 */
+	alpha_blend_span(backbuffer, backbuffer, 0);
+	
+	for (int i=1; i<no_of_threads; i++)
+		workers.push_back(std::thread(&blitter_ic::worker, this, i, worker_generation));
+}
+
+void E64::blitter_ic::blit_span(const job_t &job, uint16_t first_scanline, uint16_t end_scanline)
+{
+	/* rows of the blit that end up in the scanlines */
+	int32_t first_row, end_row;
+	if (job.ver_flip) {
+		// scrn_y = y + height_on_screen - 1 - row
+		first_row = job.y + job.height_on_screen - end_scanline;
+		end_row = job.y + job.height_on_screen - first_scanline;
+	} else {
+		// scrn_y = y + row
+		first_row = first_scanline - job.y;
+		end_row = end_scanline - job.y;
+	}
+	if (first_row < 0) first_row = 0;
+	if (end_row > job.height_on_screen) end_row = job.height_on_screen;
+	if (first_row >= end_row) return;
+	
+	uint32_t start = std::max(job.start, (uint32_t)first_row << job.width_on_screen_log2);
+	uint32_t end = std::min(job.end, (uint32_t)end_row << job.width_on_screen_log2);
+	
+	while (start < end) {
+		uint16_t row = start >> job.width_on_screen_log2;
+		uint32_t row_end = (uint32_t)(row + 1) << job.width_on_screen_log2;
+		if (row_end > end) row_end = end;
+		
+		uint16_t first_column = start & job.width_on_screen_mask;
+		uint16_t end_column = first_column + (row_end - start);
+		if (first_column < job.first_visible_column) first_column = job.first_visible_column;
+		if (end_column > job.end_visible_column) end_column = job.end_visible_column;
+		
+		if (first_column < end_column) blit_row(job, row, first_column, end_column);
+		
+		start = row_end;
+	}
+}
+
+/*
+ * Colors of a row are collected in screen order (left to right), from a
+ * kernel or from the retained surface, and blended in one go.
+ */
+void E64::blitter_ic::blit_row(const job_t &job, uint16_t row, uint16_t first_column, uint16_t end_column)
+{
+	/* row is within the visible rows, see blit_span() */
+	uint16_t scrn_y = job.y + (job.ver_flip ? (job.height_on_screen - row - 1) : row);
+	uint16_t scrn_x = job.x + (job.hor_flip ? (job.width_on_screen - end_column) : first_column);
+	uint16_t *destination = &backbuffer[scrn_x + (scrn_y * VICV_PIXELS_PER_SCANLINE)];
+	
+	uint16_t colors[VICV_PIXELS_PER_SCANLINE];
+	uint16_t no_of_colors = end_column - first_column;
+	
+	if (job.surface) {
+		const uint16_t *surface_row =
+			&job.surface[(row >> job.double_height) << job.width_log2];
+		if (!job.hor_flip && !job.double_width) {
+			alpha_blend_span(destination, &surface_row[first_column], no_of_colors);
+			return;
+		}
+		for (uint16_t i = 0; i < no_of_colors; i++) {
+			uint16_t color = surface_row[(first_column + i) >> job.double_width];
+			colors[job.hor_flip ? (no_of_colors - 1 - i) : i] = color;
+		}
+	} else {
+		(this->*row_kernels[job.kernel])(job, row, first_column, end_column, colors);
+	}
+	
+	alpha_blend_span(destination, colors, no_of_colors);
 }
 
+/*
+ * Pixel number p of a blit corresponds to row (p >> width_on_screen_log2)
+ * and column (p & width_on_screen_mask) on screen. Undoing double width
+ * and height, the position in the source is x_in_blit = column >>
+ * double_width and y_in_blit = row >> double_height.
+ *
+ * The flags that are evaluated for every pixel are template parameters,
+ * so each combination gets its own kernel without mode branches in the
+ * inner loop. Flags that only matter once per row (ver_flip,
+ * double_height and use_cbm_font) stay runtime values.
+ */
+template <bool BITMAP, bool MULTICOLOR, bool BACKGROUND, bool COLOR_PER_TILE,
+	  bool HOR_FLIP, bool DOUBLE_WIDTH>
+void E64::blitter_ic::rasterise_row(const job_t &job, uint16_t row, uint16_t first_column,
+				    uint16_t end_column, uint16_t *colors)
+{
+	uint16_t y_in_blit = row >> job.double_height;
+	uint16_t tile_row_start = (y_in_blit >> 3) << job.width_in_tiles_log2;
+	
+	const uint16_t *source = job.source;
+	uint16_t bitmap_row = y_in_blit << job.width_log2;
+	uint8_t  tile_row = (y_in_blit & 0b111) << 3;
+	
+	uint16_t fg_color = job.foreground_color;
+	uint16_t bg_color = job.background_color;
+	
+	/* colors are stored in screen order (left to right) */
+	uint16_t no_of_colors = end_column - first_column;
+	uint16_t *color = HOR_FLIP ? &colors[no_of_colors - 1] : colors;
+	
+	uint16_t column = first_column;
+	
+	while (column < end_column) {
+		/* a run of pixels within the same tile */
+		uint16_t tile_x = (column >> DOUBLE_WIDTH) >> 3;
+		uint16_t run_end = ((tile_x + 1) << 3) << DOUBLE_WIDTH;
+		if (run_end > end_column) run_end = end_column;
+		
+		uint16_t tile_number = tile_x + tile_row_start;
+		
+		/* Replace foreground and background colors if necessary */
+		if (COLOR_PER_TILE) {
+			fg_color = job.tile_color_data[tile_number & 0x7ff];
+			bg_color = job.tile_background_color_data[tile_number & 0x7ff];
+		}
+		
+		/*
+		 * Pick the right pixel depending on bitmap mode or tile mode
+		 * (source is either the cbm font or pixel data)
+		 */
+		uint16_t base = BITMAP ? bitmap_row :
+			((job.tile_data[tile_number & 0x7fff] << 6) | tile_row);
+		
+		for (; column < run_end; column++) {
+			uint16_t x_in_blit = column >> DOUBLE_WIDTH;
+			uint16_t source_color = BITMAP ?
+				source[(base | x_in_blit) & 0x3fff] :
+				source[(base | (x_in_blit & 0b111)) & 0x3fff];
+			
+			/*
+			 * If the source color has an alpha value of higher
+			 * than 0x0 (there is a pixel), and we're not in
+			 * multicolor mode, replace with foreground color.
+			 *
+			 * If there's no alpha value (no pixel), and we have
+			 * background 'on', replace the color with background
+			 * color.
+			 */
+			if (source_color & 0xf000) {
+				if (!MULTICOLOR) source_color = fg_color;
+			} else {
+				if (BACKGROUND) source_color = bg_color;
+			}
+			
+			*color = source_color;
+			if (HOR_FLIP) color--; else color++;
+		}
+	}
+}
+
+/*
+ * Row kernels indexed by (bitmap_mode | multicolor_mode << 1 |
+ * background << 2 | color_per_tile << 3 | hor_flip << 4 |
+ * double_width << 5).
+ */
+#define ROW_KERNEL(n) &E64::blitter_ic::rasterise_row<(n) & 1, ((n) >> 1) & 1, \
+	((n) >> 2) & 1, ((n) >> 3) & 1, ((n) >> 4) & 1, ((n) >> 5) & 1>
+#define ROW_KERNELS_8(n) ROW_KERNEL(n), ROW_KERNEL(n + 1), ROW_KERNEL(n + 2), \
+	ROW_KERNEL(n + 3), ROW_KERNEL(n + 4), ROW_KERNEL(n + 5), ROW_KERNEL(n + 6), \
+	ROW_KERNEL(n + 7)
+
+const E64::blitter_ic::row_kernel_t E64::blitter_ic::row_kernels[64] = {
+	ROW_KERNELS_8(0),  ROW_KERNELS_8(8),  ROW_KERNELS_8(16), ROW_KERNELS_8(24),
+	ROW_KERNELS_8(32), ROW_KERNELS_8(40), ROW_KERNELS_8(48), ROW_KERNELS_8(56)
+};
+
+#undef ROW_KERNELS_8
+#undef ROW_KERNEL
+
 void E64::blitter_ic::set_clear_color(uint16_t color)
 {
 //	clear_color = color | 0xf000;
@@ -279,11 +752,48 @@ void E64::blitter_ic::draw_blit(blit_t *blit, int16_t x, int16_t y)
 	head++;
 }
 
+/*
+ * Reads go through memory_read_8, so lists can live anywhere in blit
+ * memory. A list is at most one 64k slice long, to make sure a missing
+ * end marker can't keep the blitter fetching forever.
+ */
+void E64::blitter_ic::run_display_list()
+{
+	uint32_t address = (registers[0x0d] << 16) | (registers[0x0c] << 8);
+	uint32_t end = address + 0x10000;
+	
+	while (address < end) {
+		switch (memory_read_8(address++)) {
+			case 0b00000010:
+				clear_framebuffer();
+				break;
+			case 0b00000100:
+				draw_border();
+				break;
+			case 0b00001000:
+			{
+				uint8_t blit_no = memory_read_8(address);
+				int16_t x = memory_read_8(address + 1) | (memory_read_8(address + 2) << 8);
+				int16_t y = memory_read_8(address + 3) | (memory_read_8(address + 4) << 8);
+				draw_blit(&blit[blit_no], x, y);
+				address += 5;
+				break;
+			}
+			default:
+				return;
+		}
+	}
+}
+
 void E64::blitter_ic::swap_buffers()
 {
 	uint16_t *tempbuffer = frontbuffer;
 	frontbuffer = backbuffer;
 	backbuffer = tempbuffer;
+	
+	bool temp_transparent = front_transparent;
+	front_transparent = back_transparent;
+	back_transparent = temp_transparent;
 }
 
 uint8_t E64::blitter_ic::io_read_8(uint8_t address)
@@ -341,6 +851,9 @@ void E64::blitter_ic::io_write_8(uint8_t address, uint8_t byte)
 					break;
 				case 0b00010001:
 					break;
+				case 0b00100000:
+					run_display_list();
+					break;
 				default:
 					break;
 			}
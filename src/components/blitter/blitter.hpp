@@ -19,8 +19,8 @@
  * 0x09: clearcolor, high byte
  * 0x0a: hor border color, low byte
  * 0x0b: hor border color, high byte
- * 0x0c:
- * 0x0d:
+ * 0x0c: display list page (low byte)
+ * 0x0d: display list page (high byte)
  * 0x0e: memory access page (low byte)
  * 0x0f: memory access page (high byte)
  *
@@ -31,6 +31,23 @@
  *
  */
 
+/*
+ * Display lists
+ *
+ * Writing 0b00100000 to the control register runs the display list that
+ * starts at the display list page (0x0c/0x0d) of blit memory. Entries
+ * are packed, the first byte of each entry uses the same bits as the
+ * control register:
+ *
+ * 0b00000010: clear framebuffer
+ * 0b00000100: draw border
+ * 0b00001000: blit, followed by blit_no, x (low, high) and y (low, high)
+ *
+ * Any other byte ends the list (0x00 by convention). The whole list is
+ * fetched at once and its operations are queued like the ones written
+ * through the registers. Registers 0x01 and 0x04-0x07 are left alone.
+ */
+
 /*
  * Blitter is able to copy data very fast from video memory location to
  * backbuffer (framebuffer). Copy operations run independently and can be added
@@ -41,9 +58,15 @@
 #define BLIT_HPP
 
 #include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #define COMMAND_BUFFER_SIZE 63+(3*64)
 
+#define BLITTER_MAX_THREADS 16
+
 namespace E64
 {
 
@@ -230,6 +253,22 @@ class blitter_ic {
 private:
 	uint8_t	registers[32];
 	uint8_t *blit_memory;
+	
+	/*
+	 * Blit memory is filled with a pattern, one 64k slice at a time, as
+	 * soon as the slice is used. Until then, reads give the pattern
+	 * without touching memory.
+	 */
+	bool slice_filled[256];
+	void fill_slice(uint8_t slice);
+	inline void touch_slice(uint8_t slice)
+	{
+		if (!slice_filled[slice]) fill_slice(slice);
+	}
+	static inline uint8_t fill_pattern(uint32_t address)
+	{
+		return (address & 0b1) ? (address & 0xff0000) >> 16 : (address & 0x00ff00) >> 8;
+	}
 	uint16_t *cbm_font;	// pointer to unpacked font
 	
 	enum blitter_state_t blitter_state;
@@ -237,6 +276,14 @@ private:
 	// framebuffer pointers
 	uint16_t *fb0;
 	uint16_t *fb1;
+	
+	/*
+	 * A buffer is known to be fully transparent after a complete clear
+	 * with a transparent color, until something else is drawn on it.
+	 */
+	bool front_transparent;
+	bool back_transparent;
+	bool clear_transparent;		// current clear only used alpha 0
 
 	/*
 	 * Circular buffer containing operations. If more than 65536 operations
@@ -272,7 +319,6 @@ private:
 	
 	uint32_t total_no_of_pix;       // total number of pixels to blit onto framebuffer for this blit
 	uint32_t pixel_no;              // current pixel of the total that is being processed
-	uint32_t normalized_pixel_no;   // normalized to the dimensions of source
     
 	// specific for clearing framebuffer
 	uint16_t clear_color;
@@ -284,25 +330,16 @@ private:
 	int16_t x;
 	int16_t y;
 	
-	uint16_t scrn_x;            // final screen x for the current pixel
-	uint16_t scrn_y;            // final screen y for the current pixel
-	
-	uint16_t x_in_blit;
-	uint16_t y_in_blit;
-	
-	uint16_t tile_x;
-	uint16_t tile_y;
-	
-	
-	uint16_t tile_number;
-	uint8_t  tile_index;
-	uint16_t current_background_color;
-	uint8_t  pixel_in_tile;
-	
-	uint16_t source_color;
-	
 	uint16_t width_mask;
 	uint16_t width_on_screen_mask;
+	
+	/*
+	 * Columns and rows of the blit (on screen, so possibly doubled)
+	 * that end up inside the framebuffer. Computed once per blit.
+	 */
+	uint16_t first_visible_column;
+	uint16_t end_visible_column;
+	bool     visible;
     
 	uint16_t foreground_color;
 	uint16_t background_color;
@@ -314,6 +351,124 @@ private:
 	uint32_t user_data;
 	
 	inline void check_new_operation();
+	
+	void run_display_list();
+	
+	struct job_t;
+	
+	/*
+	 * One kernel per combination of the flags that are checked for
+	 * every pixel, picked once per blit from a dispatch table. A kernel
+	 * stores the colors of (part of) a row in screen order.
+	 */
+	template <bool BITMAP, bool MULTICOLOR, bool BACKGROUND, bool COLOR_PER_TILE,
+		  bool HOR_FLIP, bool DOUBLE_WIDTH>
+	void rasterise_row(const job_t &job, uint16_t row, uint16_t first_column,
+			   uint16_t end_column, uint16_t *colors);
+	
+	typedef void (blitter_ic::*row_kernel_t)(const job_t &job, uint16_t row,
+						 uint16_t first_column, uint16_t end_column,
+						 uint16_t *colors);
+	static const row_kernel_t row_kernels[64];
+	
+	/*
+	 * Pixels start up to end of one operation, with everything needed
+	 * to draw them. The finite state machine does the cycle accounting
+	 * and hands these out, the pixel work is done afterwards.
+	 */
+	struct job_t {
+		enum blitter_state_t type;
+		uint32_t start;
+		uint32_t end;
+		uint16_t color;		// clear or border color
+		
+		uint8_t  kernel;	// index in row_kernels
+		uint16_t blit_no;	// descriptor, 256 if not one of ours
+		const uint16_t *surface;	// retained surface, or nullptr
+		const uint16_t *source;
+		uint8_t  *tile_data;
+		uint16_t *tile_color_data;
+		uint16_t *tile_background_color_data;
+		int16_t  x;
+		int16_t  y;
+		bool     hor_flip;
+		bool     ver_flip;
+		uint16_t double_width;
+		uint16_t double_height;
+		uint16_t width_log2;
+		uint16_t height_log2;
+		uint16_t width_in_tiles_log2;
+		uint16_t width_on_screen_log2;
+		uint16_t width_on_screen_mask;
+		uint16_t width_on_screen;
+		uint16_t height_on_screen;
+		uint16_t foreground_color;
+		uint16_t background_color;
+		uint16_t first_visible_column;
+		uint16_t end_visible_column;
+	};
+	
+	/*
+	 * Rasterised contents of a descriptor, and what they were made
+	 * from.
+	 */
+	struct surface_t {
+		uint16_t *pixels;
+		uint32_t size;
+		bool     drawn;
+		bool     rasterised;
+		uint8_t  kernel;
+		const uint16_t *source;
+		uint16_t width_log2;
+		uint16_t height_log2;
+		uint16_t foreground_color;
+		uint16_t background_color;
+		uint32_t generation;
+		uint32_t batch;		// last batch of jobs using the pixels
+		uint8_t  *tile_data;
+		uint16_t *tile_color_data;
+		uint16_t *tile_background_color_data;
+	};
+	
+	surface_t surfaces[256];
+	uint32_t batch;				// jobs done so far
+	uint32_t memory_generation[256];	// per 64k slice of blit memory
+	
+	const uint16_t *retained_surface(const job_t &job);
+	
+	job_t job;			// current operation
+	bool job_queued;		// current operation already has a job
+	std::vector<job_t> jobs;
+	
+	void advance(int no_of_cycles);
+	inline void queue_job(uint32_t start, uint32_t end);
+	void do_jobs();
+	
+	/*
+	 * Span engine. Blits the pixels of a job that end up in scanlines
+	 * first_scanline up to end_scanline, row by row. Clipped parts are
+	 * skipped, and tile index and colors are looked up once per tile
+	 * run.
+	 */
+	void blit_span(const job_t &job, uint16_t first_scanline, uint16_t end_scanline);
+	void blit_row(const job_t &job, uint16_t row, uint16_t first_column, uint16_t end_column);
+	
+	/*
+	 * Optional worker threads. The framebuffer is split in horizontal
+	 * bands, one per thread (the calling thread takes band 0), and
+	 * each thread does all jobs clipped to its own band.
+	 */
+	std::vector<std::thread> workers;
+	std::mutex worker_mutex;
+	std::condition_variable worker_wake;
+	std::condition_variable worker_done;
+	uint32_t worker_generation;
+	int workers_running;
+	bool workers_quit;
+	
+	void do_band(int band);
+	void worker(int band, uint32_t generation);
+	void stop_workers();
 public:
 	blitter_ic();
 	~blitter_ic();
@@ -330,14 +485,27 @@ public:
 		if (((blit[(address & 0x00ff0000) >> 16].flags_0) & 0b10000000)
 		    && !(address & 0x00008000)) {
 			return ((uint8_t *)cbm_font)[address & 0x7fff];
-		} else {
+		} else if (slice_filled[(address & 0x00ff0000) >> 16]) {
 			return blit_memory[address & 0x00ffffff];
+		} else {
+			return fill_pattern(address);
 		}
 	}
 	
 	inline void memory_write_8(uint32_t address, uint8_t value)
 	{
+		touch_slice((address & 0x00ff0000) >> 16);
 		blit_memory[address & 0x00ffffff] = value;
+		memory_generation[(address & 0x00ff0000) >> 16]++;
+	}
+	
+	/*
+	 * To be called after writing to the memory of a blit directly
+	 * through its pointers, instead of with memory_write_8.
+	 */
+	inline void memory_modified(uint8_t blit_no)
+	{
+		memory_generation[blit_no]++;
 	}
 	
 	// used from inside the machine (which can not access 16mb of flat memory)
@@ -425,12 +593,24 @@ public:
 	uint16_t *frontbuffer;
 	uint16_t *backbuffer;
 	
+	inline bool frontbuffer_transparent() { return front_transparent; }
+	
 	void reset();
 	void run(int no_of_cycles);
 	//inline void make_idle() { blitter_state = IDLE; }
 	
 	struct blit_t *blit;	// 2048 bytes (256 * 8) for E64, another 2048 for host
 	
+	/*
+	 * Use this to get a descriptor when its memory is going to be
+	 * accessed through its pointers.
+	 */
+	inline blit_t *get_blit(uint8_t blit_no)
+	{
+		touch_slice(blit_no);
+		return &blit[blit_no];
+	}
+	
 	void set_clear_color(uint16_t color);
 	void set_border_color(uint16_t color) { border_color = color; }
 	void set_border_size(uint8_t size ) { border_size = size; }
@@ -442,9 +622,14 @@ public:
 	inline bool busy() { return blitter_state == IDLE ? false : true; }
 	
 	// run cycles until not busy anymore
-	inline void flush() {
-		do run(1000); while (busy());
-	}
+	void flush();
+	
+	/*
+	 * Number of threads that draw (1 up to BLITTER_MAX_THREADS). The
+	 * result is identical for any number.
+	 */
+	void set_threads(int no_of_threads);
+	inline int get_threads() { return (int)workers.size() + 1; }
 };
 
 }
@@ -223,8 +223,9 @@ inline char event_to_ascii(uint8_t scancode, uint8_t modifiers)
     return 0;
 }
 
-E64::cia_ic::cia_ic()
+E64::cia_ic::cia_ic(scheduler_t *s)
 {
+    scheduler = s;
     cycles_per_interval = VICV_CLOCK_SPEED / 100; // no of cycles @ vicv clockspeed for a total of 10 ms
     reset();
 }
@@ -244,6 +245,8 @@ void E64::cia_ic::reset()
     keyboard_repeat_delay = 50;
     keyboard_repeat_speed = 5;
     keyboard_repeat_counter = 0;
+    
+    scheduler->schedule_in(SCHEDULER_CIA, cycles_per_interval);
 }
 
 void E64::cia_ic::push_event(uint8_t event)
@@ -324,6 +327,9 @@ void E64::cia_ic::run(int no_of_cycles)
             }
         }
     }
+    
+    scheduler->schedule_in(SCHEDULER_CIA, (cycle_counter < cycles_per_interval) ?
+                           cycles_per_interval - cycle_counter : 1);
 }
 
 uint8_t E64::cia_ic::read_byte(uint8_t address)
@@ -35,6 +35,7 @@
  */
 
 #include <cstdint>
+#include "scheduler.hpp"
 
 #ifndef cia_hpp
 #define cia_hpp
@@ -123,6 +124,8 @@ private:
     uint32_t    cycle_counter;
     uint32_t    cycles_per_interval;
     
+    scheduler_t *scheduler;
+    
     void    push_event(uint8_t event);
     uint8_t pop_event();
     
@@ -149,7 +152,7 @@ private:
     }
     
 public:
-    cia_ic();
+    cia_ic(scheduler_t *s);
     
     // reset, also called by constructor
     void reset();
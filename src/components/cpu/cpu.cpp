@@ -1,113 +1,1678 @@
+//  cpu.cpp
+//  E64
+//
+//  Copyright © 2019-2021 elmerucr. All rights reserved.
+
 #include "cpu.hpp"
 #include <cstdio>
 #include <cstring>
 
-extern "C" {
-#include "fake6502.h"
-}
-
 #include "mnemonics.h"
 
-cpu_ic::cpu_ic()
+const uint8_t E64::cpu_ic::ticktable[256] = {
+/*        |  0  |  1  |  2  |  3  |  4  |  5  |  6  |  7  |  8  |  9  |  A  |  B  |  C  |  D  |  E  |  F  |     */
+/* 0 */       7,    6,    2,    2,    5,    3,    5,    5,    3,    2,    2,    2,    6,    4,    6,    2, /* 0 */
+/* 1 */       2,    5,    5,    2,    5,    4,    6,    5,    2,    4,    2,    2,    6,    4,    7,    2, /* 1 */
+/* 2 */       6,    6,    2,    2,    3,    3,    5,    5,    4,    2,    2,    2,    4,    4,    6,    2, /* 2 */
+/* 3 */       2,    5,    5,    2,    4,    4,    6,    5,    2,    4,    2,    2,    4,    4,    7,    2, /* 3 */
+/* 4 */       6,    6,    2,    2,    2,    3,    5,    5,    3,    2,    2,    2,    3,    4,    6,    2, /* 4 */
+/* 5 */       2,    5,    5,    2,    2,    4,    6,    5,    2,    4,    3,    2,    2,    4,    7,    2, /* 5 */
+/* 6 */       6,    6,    2,    2,    3,    3,    5,    5,    4,    2,    2,    2,    5,    4,    6,    2, /* 6 */
+/* 7 */       2,    5,    5,    2,    4,    4,    6,    5,    2,    4,    4,    2,    6,    4,    7,    2, /* 7 */
+/* 8 */       3,    6,    2,    2,    3,    3,    3,    5,    2,    2,    2,    2,    4,    4,    4,    2, /* 8 */
+/* 9 */       2,    6,    5,    2,    4,    4,    4,    5,    2,    5,    2,    2,    4,    5,    5,    2, /* 9 */
+/* A */       2,    6,    2,    2,    3,    3,    3,    5,    2,    2,    2,    2,    4,    4,    4,    2, /* A */
+/* B */       2,    5,    5,    2,    4,    4,    4,    5,    2,    4,    2,    2,    4,    4,    4,    2, /* B */
+/* C */       2,    6,    2,    2,    3,    3,    5,    5,    2,    2,    2,    3,    4,    4,    6,    2, /* C */
+/* D */       2,    5,    5,    2,    2,    4,    6,    5,    2,    4,    3,    1,    2,    4,    7,    2, /* D */
+/* E */       2,    6,    2,    2,    3,    3,    5,    5,    2,    2,    2,    2,    4,    4,    6,    2, /* E */
+/* F */       2,    5,    5,    2,    2,    4,    6,    5,    2,    4,    4,    2,    2,    4,    7,    2  /* F */
+};
+
+const uint8_t E64::cpu_ic::lengthtable[256] = {
+/*        |  0  |  1  |  2  |  3  |  4  |  5  |  6  |  7  |  8  |  9  |  A  |  B  |  C  |  D  |  E  |  F  |     */
+/* 0 */       1,    2,    1,    1,    2,    2,    2,    2,    1,    2,    1,    1,    3,    3,    3,    3, /* 0 */
+/* 1 */       2,    2,    2,    1,    2,    2,    2,    2,    1,    3,    1,    1,    3,    3,    3,    3, /* 1 */
+/* 2 */       3,    2,    1,    1,    2,    2,    2,    2,    1,    2,    1,    1,    3,    3,    3,    3, /* 2 */
+/* 3 */       2,    2,    2,    1,    2,    2,    2,    2,    1,    3,    1,    1,    3,    3,    3,    3, /* 3 */
+/* 4 */       1,    2,    1,    1,    1,    2,    2,    2,    1,    2,    1,    1,    3,    3,    3,    3, /* 4 */
+/* 5 */       2,    2,    2,    1,    1,    2,    2,    2,    1,    3,    1,    1,    1,    3,    3,    3, /* 5 */
+/* 6 */       1,    2,    1,    1,    2,    2,    2,    2,    1,    2,    1,    1,    3,    3,    3,    3, /* 6 */
+/* 7 */       2,    2,    2,    1,    2,    2,    2,    2,    1,    3,    1,    1,    3,    3,    3,    3, /* 7 */
+/* 8 */       2,    2,    1,    1,    2,    2,    2,    2,    1,    2,    1,    1,    3,    3,    3,    3, /* 8 */
+/* 9 */       2,    2,    2,    1,    2,    2,    2,    2,    1,    3,    1,    1,    3,    3,    3,    3, /* 9 */
+/* A */       2,    2,    2,    1,    2,    2,    2,    2,    1,    2,    1,    1,    3,    3,    3,    3, /* A */
+/* B */       2,    2,    2,    1,    2,    2,    2,    2,    1,    3,    1,    1,    3,    3,    3,    3, /* B */
+/* C */       2,    2,    1,    1,    2,    2,    2,    2,    1,    2,    1,    1,    3,    3,    3,    3, /* C */
+/* D */       2,    2,    2,    1,    1,    2,    2,    2,    1,    3,    1,    1,    1,    3,    3,    3, /* D */
+/* E */       2,    2,    1,    1,    2,    2,    2,    2,    1,    2,    1,    1,    3,    3,    3,    3, /* E */
+/* F */       2,    2,    2,    1,    1,    2,    2,    2,    1,    3,    1,    1,    1,    3,    3,    3  /* F */
+};
+
+E64::cpu_ic::cpu_ic(mmu_ic *unit)
 {
-//	*irq_line = true;
-//	*nmi_line = true;
+	mmu = unit;
+
 	old_nmi_line = true;
+	interrupt_check = true;
+
+	pc = 0;
+	sp = 0xfd;
+	a = x = y = 0;
+	status = FLAG_CONSTANT;
+	clockticks = 0;
+	waiting = false;
+
+	debug_flags = new uint8_t[65536];
+	for (int i=0; i<65536; i++) debug_flags[i] = 0;
+	breakpoints = new uint16_t[65536];
+	no_of_breakpoints = 0;
+	watchpoints = new uint16_t[65536];
+	no_of_watchpoints = 0;
+	watching = false;
+	watchpoint_reached = false;
+
+	no_idle_loop = new bool[65536];
+	for (int i=0; i<65536; i++) no_idle_loop[i] = false;
+
+	verify_ram = new uint8_t[65536];
+
+	blocks = new struct block_t[BLOCK_CACHE_SIZE];
+	for (int i=0; i<256; i++) page_generation[i] = 0;
+	flush_blocks();
+
+	engine = CPU_ENGINE_BLOCKS;
+}
+
+E64::cpu_ic::~cpu_ic()
+{
+	delete [] blocks;
+	delete [] verify_ram;
+	delete [] no_idle_loop;
+	delete [] watchpoints;
+	delete [] breakpoints;
+	delete [] debug_flags;
+}
+
+void E64::cpu_ic::reset()
+{
+	pc = read_8(0xfffc) | (read_8(0xfffd) << 8);
+	a = 0;
+	x = 0;
+	y = 0;
+	sp = 0xfd;
+	status |= FLAG_CONSTANT | FLAG_INTERRUPT;
+	waiting = false;
+	interrupt_check = true;
+
+	// rom image and ram contents may have changed
+	for (int i=0; i<65536; i++) no_idle_loop[i] = false;
+	flush_blocks();
+}
+
+void E64::cpu_ic::flush_blocks()
+{
+	for (int i=0; i<BLOCK_CACHE_SIZE; i++) {
+		blocks[i].start = 0;
+		blocks[i].no_of_instructions = 0;
+		blocks[i].executions = 0;
+	}
+	code_modified = false;
+}
+
+void E64::cpu_ic::set_engine(enum cpu_engine e)
+{
+	engine = e;
+	flush_blocks();
+}
+
+const char *E64::cpu_ic::engine_name()
+{
+	switch (engine) {
+	case CPU_ENGINE_INTERPRETER:
+		return "interpreter";
+	case CPU_ENGINE_BLOCKS:
+		return "blocks";
+	case CPU_ENGINE_VERIFY:
+		return "verify";
+	}
+	return "unknown";
+}
+
+/*
+ * Sorted sets of addresses
+ */
+static void insert_address(uint16_t *set, int *n, uint16_t address)
+{
+	int i = *n;
+	while ((i > 0) && (set[i - 1] > address)) {
+		set[i] = set[i - 1];
+		i--;
+	}
+	set[i] = address;
+	(*n)++;
+}
+
+static void remove_address(uint16_t *set, int *n, uint16_t address)
+{
+	int i = 0;
+	while ((i < *n) && (set[i] != address)) i++;
+	if (i == *n) return;
+	(*n)--;
+	for (; i < *n; i++) set[i] = set[i + 1];
+}
+
+void E64::cpu_ic::clear_breakpoints()
+{
+	for (int i=0; i<no_of_breakpoints; i++)
+		debug_flags[breakpoints[i]] &= ~DEBUG_BREAKPOINT;
+	no_of_breakpoints = 0;
+}
+
+void E64::cpu_ic::toggle_breakpoint(uint16_t address)
+{
+	debug_flags[address] ^= DEBUG_BREAKPOINT;
+	if (debug_flags[address] & DEBUG_BREAKPOINT) {
+		insert_address(breakpoints, &no_of_breakpoints, address);
+	} else {
+		remove_address(breakpoints, &no_of_breakpoints, address);
+	}
+}
+
+void E64::cpu_ic::toggle_watchpoint(uint16_t address, uint8_t flags)
+{
+	uint8_t old_flags = get_watchpoint(address);
+
+	flags &= DEBUG_WATCH_READ | DEBUG_WATCH_WRITE;
+	debug_flags[address] ^= flags;
+
+	if (flags & DEBUG_WATCH_READ)
+		mmu->watch_address(address, false, debug_flags[address] & DEBUG_WATCH_READ);
+	if (flags & DEBUG_WATCH_WRITE)
+		mmu->watch_address(address, true, debug_flags[address] & DEBUG_WATCH_WRITE);
+
+	if (!old_flags && get_watchpoint(address)) {
+		insert_address(watchpoints, &no_of_watchpoints, address);
+	} else if (old_flags && !get_watchpoint(address)) {
+		remove_address(watchpoints, &no_of_watchpoints, address);
+	}
+}
+
+void E64::cpu_ic::clear_watchpoints()
+{
+	while (no_of_watchpoints)
+		toggle_watchpoint(watchpoints[0], get_watchpoint(watchpoints[0]));
+}
+
+bool E64::cpu_ic::watchpoint_hit(uint16_t *address, bool *write)
+{
+	*address = watchpoint_address;
+	*write = watchpoint_write;
+	return watchpoint_reached;
+}
+
+/*
+ * 65c02: decimal mode adc and sbc set n and z, and take one extra cycle
+ */
+void E64::cpu_ic::op_adc(uint8_t value)
+{
+	uint16_t result;
+
+	if (status & FLAG_DECIMAL) {
+		uint16_t lo = (a & 0x0f) + (value & 0x0f) + (status & FLAG_CARRY);
+		uint16_t hi = (a & 0xf0) + (value & 0xf0);
+		if (lo > 0x09) {
+			hi += 0x10;
+			lo += 0x06;
+		}
+		if (hi > 0x90) hi += 0x60;
+		set_carry(hi & 0xff00);
+		result = (lo & 0x0f) | (hi & 0xf0);
+		clockticks++;
+	} else {
+		result = a + value + (status & FLAG_CARRY);
+		set_carry(result & 0xff00);
+		status = ((result ^ a) & (result ^ value) & 0x80) ?
+			(status | FLAG_OVERFLOW) : (status & ~FLAG_OVERFLOW);
+	}
+	a = load(result & 0xff);
+}
+
+void E64::cpu_ic::op_sbc(uint8_t value)
+{
+	uint16_t result;
+
+	if (status & FLAG_DECIMAL) {
+		result = a - (value & 0x0f) + (status & FLAG_CARRY) - 1;
+		if ((result & 0x0f) > (a & 0x0f)) result -= 6;
+		result -= (value & 0xf0);
+		if ((result & 0xfff0) > (a & 0xf0)) result -= 0x60;
+		set_carry(result <= a);
+		clockticks++;
+	} else {
+		value ^= 0xff;
+		result = a + value + (status & FLAG_CARRY);
+		set_carry(result & 0xff00);
+		status = ((result ^ a) & (result ^ value) & 0x80) ?
+			(status | FLAG_OVERFLOW) : (status & ~FLAG_OVERFLOW);
+	}
+	a = load(result & 0xff);
+}
+
+/*
+ * 65c02: brk clears the decimal flag
+ */
+void E64::cpu_ic::brk()
+{
+	pc++;
+	push_16(pc);
+	push_8(status | FLAG_BREAK);
+	status |= FLAG_INTERRUPT;
+	status &= ~FLAG_DECIMAL;
+	pc = read_8(0xfffe) | (read_8(0xffff) << 8);
+}
+
+void E64::cpu_ic::nmi()
+{
+	push_16(pc);
+	push_8(status);
+	status |= FLAG_INTERRUPT;
+	pc = read_8(0xfffa) | (read_8(0xfffb) << 8);
+	waiting = false;
+	clockticks += 7;
+}
+
+void E64::cpu_ic::irq()
+{
+	push_16(pc);
+	push_8(status & ~FLAG_BREAK);
+	status |= FLAG_INTERRUPT;
+	pc = read_8(0xfffe) | (read_8(0xffff) << 8);
+	waiting = false;
+	clockticks += 7;
+}
+
+inline void E64::cpu_ic::execute(uint8_t opcode)
+{
+	uint16_t ea;
+
+	status |= FLAG_CONSTANT;
+
+	switch (opcode) {
+	case 0x00:	/* brk */
+		brk();
+		break;
+	case 0x01:	/* ora ($nn,x) */
+		op_ora(read_8(indx()));
+		break;
+	case 0x02:	/* nop */
+		break;
+	case 0x03:	/* nop */
+		break;
+	case 0x04:	/* tsb $nn */
+		ea = zp();
+		write_8(ea, op_tsb(read_8(ea)));
+		break;
+	case 0x05:	/* ora $nn */
+		op_ora(read_8(zp()));
+		break;
+	case 0x06:	/* asl $nn */
+		ea = zp();
+		write_8(ea, op_asl(read_8(ea)));
+		break;
+	case 0x07:	/* rmb0 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) & ~0x01);
+		break;
+	case 0x08:	/* php */
+		push_8(status | FLAG_BREAK);
+		break;
+	case 0x09:	/* ora #$nn */
+		op_ora((uint8_t)operand);
+		break;
+	case 0x0a:	/* asl a */
+		a = op_asl(a);
+		break;
+	case 0x0b:	/* nop */
+		break;
+	case 0x0c:	/* tsb $nnnn */
+		ea = abso();
+		write_8(ea, op_tsb(read_8(ea)));
+		break;
+	case 0x0d:	/* ora $nnnn */
+		op_ora(read_8(abso()));
+		break;
+	case 0x0e:	/* asl $nnnn */
+		ea = abso();
+		write_8(ea, op_asl(read_8(ea)));
+		break;
+	case 0x0f:	/* bbr0 $nn, $nnnn */
+		branch_bit(0x01, false);
+		break;
+	case 0x10:	/* bpl $nn */
+		branch(!(status & FLAG_SIGN));
+		break;
+	case 0x11:	/* ora ($nn),y */
+		op_ora(read_8(indy(true)));
+		break;
+	case 0x12:	/* ora ($nn) */
+		op_ora(read_8(ind0()));
+		break;
+	case 0x13:	/* nop */
+		break;
+	case 0x14:	/* trb $nn */
+		ea = zp();
+		write_8(ea, op_trb(read_8(ea)));
+		break;
+	case 0x15:	/* ora $nn,x */
+		op_ora(read_8(zpx()));
+		break;
+	case 0x16:	/* asl $nn,x */
+		ea = zpx();
+		write_8(ea, op_asl(read_8(ea)));
+		break;
+	case 0x17:	/* rmb1 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) & ~0x02);
+		break;
+	case 0x18:	/* clc */
+		status &= ~FLAG_CARRY;
+		break;
+	case 0x19:	/* ora $nnnn,y */
+		op_ora(read_8(absy(true)));
+		break;
+	case 0x1a:	/* inc a */
+		a = op_inc(a);
+		break;
+	case 0x1b:	/* nop */
+		break;
+	case 0x1c:	/* trb $nnnn */
+		ea = abso();
+		write_8(ea, op_trb(read_8(ea)));
+		break;
+	case 0x1d:	/* ora $nnnn,x */
+		op_ora(read_8(absx(true)));
+		break;
+	case 0x1e:	/* asl $nnnn,x */
+		ea = absx();
+		write_8(ea, op_asl(read_8(ea)));
+		break;
+	case 0x1f:	/* bbr1 $nn, $nnnn */
+		branch_bit(0x02, false);
+		break;
+	case 0x20:	/* jsr $nnnn */
+		jsr(abso());
+		break;
+	case 0x21:	/* and ($nn,x) */
+		op_and(read_8(indx()));
+		break;
+	case 0x22:	/* nop */
+		break;
+	case 0x23:	/* nop */
+		break;
+	case 0x24:	/* bit $nn */
+		op_bit(read_8(zp()));
+		break;
+	case 0x25:	/* and $nn */
+		op_and(read_8(zp()));
+		break;
+	case 0x26:	/* rol $nn */
+		ea = zp();
+		write_8(ea, op_rol(read_8(ea)));
+		break;
+	case 0x27:	/* rmb2 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) & ~0x04);
+		break;
+	case 0x28:	/* plp */
+		status = pull_8() | FLAG_CONSTANT;
+		interrupt_check = true;
+		break;
+	case 0x29:	/* and #$nn */
+		op_and((uint8_t)operand);
+		break;
+	case 0x2a:	/* rol a */
+		a = op_rol(a);
+		break;
+	case 0x2b:	/* nop */
+		break;
+	case 0x2c:	/* bit $nnnn */
+		op_bit(read_8(abso()));
+		break;
+	case 0x2d:	/* and $nnnn */
+		op_and(read_8(abso()));
+		break;
+	case 0x2e:	/* rol $nnnn */
+		ea = abso();
+		write_8(ea, op_rol(read_8(ea)));
+		break;
+	case 0x2f:	/* bbr2 $nn, $nnnn */
+		branch_bit(0x04, false);
+		break;
+	case 0x30:	/* bmi $nn */
+		branch(status & FLAG_SIGN);
+		break;
+	case 0x31:	/* and ($nn),y */
+		op_and(read_8(indy(true)));
+		break;
+	case 0x32:	/* and ($nn) */
+		op_and(read_8(ind0()));
+		break;
+	case 0x33:	/* nop */
+		break;
+	case 0x34:	/* bit $nn,x */
+		op_bit(read_8(zpx()));
+		break;
+	case 0x35:	/* and $nn,x */
+		op_and(read_8(zpx()));
+		break;
+	case 0x36:	/* rol $nn,x */
+		ea = zpx();
+		write_8(ea, op_rol(read_8(ea)));
+		break;
+	case 0x37:	/* rmb3 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) & ~0x08);
+		break;
+	case 0x38:	/* sec */
+		status |= FLAG_CARRY;
+		break;
+	case 0x39:	/* and $nnnn,y */
+		op_and(read_8(absy(true)));
+		break;
+	case 0x3a:	/* dec a */
+		a = op_dec(a);
+		break;
+	case 0x3b:	/* nop */
+		break;
+	case 0x3c:	/* bit $nnnn,x */
+		op_bit(read_8(absx()));
+		break;
+	case 0x3d:	/* and $nnnn,x */
+		op_and(read_8(absx(true)));
+		break;
+	case 0x3e:	/* rol $nnnn,x */
+		ea = absx();
+		write_8(ea, op_rol(read_8(ea)));
+		break;
+	case 0x3f:	/* bbr3 $nn, $nnnn */
+		branch_bit(0x08, false);
+		break;
+	case 0x40:	/* rti */
+		status = pull_8();
+		pc = pull_16();
+		interrupt_check = true;
+		break;
+	case 0x41:	/* eor ($nn,x) */
+		op_eor(read_8(indx()));
+		break;
+	case 0x42:	/* nop */
+		break;
+	case 0x43:	/* nop */
+		break;
+	case 0x44:	/* nop */
+		break;
+	case 0x45:	/* eor $nn */
+		op_eor(read_8(zp()));
+		break;
+	case 0x46:	/* lsr $nn */
+		ea = zp();
+		write_8(ea, op_lsr(read_8(ea)));
+		break;
+	case 0x47:	/* rmb4 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) & ~0x10);
+		break;
+	case 0x48:	/* pha */
+		push_8(a);
+		break;
+	case 0x49:	/* eor #$nn */
+		op_eor((uint8_t)operand);
+		break;
+	case 0x4a:	/* lsr a */
+		a = op_lsr(a);
+		break;
+	case 0x4b:	/* nop */
+		break;
+	case 0x4c:	/* jmp $nnnn */
+		pc = abso();
+		break;
+	case 0x4d:	/* eor $nnnn */
+		op_eor(read_8(abso()));
+		break;
+	case 0x4e:	/* lsr $nnnn */
+		ea = abso();
+		write_8(ea, op_lsr(read_8(ea)));
+		break;
+	case 0x4f:	/* bbr4 $nn, $nnnn */
+		branch_bit(0x10, false);
+		break;
+	case 0x50:	/* bvc $nn */
+		branch(!(status & FLAG_OVERFLOW));
+		break;
+	case 0x51:	/* eor ($nn),y */
+		op_eor(read_8(indy(true)));
+		break;
+	case 0x52:	/* eor ($nn) */
+		op_eor(read_8(ind0()));
+		break;
+	case 0x53:	/* nop */
+		break;
+	case 0x54:	/* nop */
+		break;
+	case 0x55:	/* eor $nn,x */
+		op_eor(read_8(zpx()));
+		break;
+	case 0x56:	/* lsr $nn,x */
+		ea = zpx();
+		write_8(ea, op_lsr(read_8(ea)));
+		break;
+	case 0x57:	/* rmb5 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) & ~0x20);
+		break;
+	case 0x58:	/* cli */
+		status &= ~FLAG_INTERRUPT;
+		interrupt_check = true;
+		break;
+	case 0x59:	/* eor $nnnn,y */
+		op_eor(read_8(absy(true)));
+		break;
+	case 0x5a:	/* phy */
+		push_8(y);
+		break;
+	case 0x5b:	/* nop */
+		break;
+	case 0x5c:	/* nop */
+		break;
+	case 0x5d:	/* eor $nnnn,x */
+		op_eor(read_8(absx(true)));
+		break;
+	case 0x5e:	/* lsr $nnnn,x */
+		ea = absx();
+		write_8(ea, op_lsr(read_8(ea)));
+		break;
+	case 0x5f:	/* bbr5 $nn, $nnnn */
+		branch_bit(0x20, false);
+		break;
+	case 0x60:	/* rts */
+		pc = pull_16() + 1;
+		break;
+	case 0x61:	/* adc ($nn,x) */
+		op_adc(read_8(indx()));
+		break;
+	case 0x62:	/* nop */
+		break;
+	case 0x63:	/* nop */
+		break;
+	case 0x64:	/* stz $nn */
+		write_8(zp(), 0);
+		break;
+	case 0x65:	/* adc $nn */
+		op_adc(read_8(zp()));
+		break;
+	case 0x66:	/* ror $nn */
+		ea = zp();
+		write_8(ea, op_ror(read_8(ea)));
+		break;
+	case 0x67:	/* rmb6 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) & ~0x40);
+		break;
+	case 0x68:	/* pla */
+		a = load(pull_8());
+		break;
+	case 0x69:	/* adc #$nn */
+		op_adc((uint8_t)operand);
+		break;
+	case 0x6a:	/* ror a */
+		a = op_ror(a);
+		break;
+	case 0x6b:	/* nop */
+		break;
+	case 0x6c:	/* jmp ($nnnn) */
+		pc = ind();
+		break;
+	case 0x6d:	/* adc $nnnn */
+		op_adc(read_8(abso()));
+		break;
+	case 0x6e:	/* ror $nnnn */
+		ea = abso();
+		write_8(ea, op_ror(read_8(ea)));
+		break;
+	case 0x6f:	/* bbr6 $nn, $nnnn */
+		branch_bit(0x40, false);
+		break;
+	case 0x70:	/* bvs $nn */
+		branch(status & FLAG_OVERFLOW);
+		break;
+	case 0x71:	/* adc ($nn),y */
+		op_adc(read_8(indy(true)));
+		break;
+	case 0x72:	/* adc ($nn) */
+		op_adc(read_8(ind0()));
+		break;
+	case 0x73:	/* nop */
+		break;
+	case 0x74:	/* stz $nn,x */
+		write_8(zpx(), 0);
+		break;
+	case 0x75:	/* adc $nn,x */
+		op_adc(read_8(zpx()));
+		break;
+	case 0x76:	/* ror $nn,x */
+		ea = zpx();
+		write_8(ea, op_ror(read_8(ea)));
+		break;
+	case 0x77:	/* rmb7 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) & ~0x80);
+		break;
+	case 0x78:	/* sei */
+		status |= FLAG_INTERRUPT;
+		break;
+	case 0x79:	/* adc $nnnn,y */
+		op_adc(read_8(absy(true)));
+		break;
+	case 0x7a:	/* ply */
+		y = load(pull_8());
+		break;
+	case 0x7b:	/* nop */
+		break;
+	case 0x7c:	/* jmp ($nnnn,x) */
+		pc = ainx();
+		break;
+	case 0x7d:	/* adc $nnnn,x */
+		op_adc(read_8(absx(true)));
+		break;
+	case 0x7e:	/* ror $nnnn,x */
+		ea = absx();
+		write_8(ea, op_ror(read_8(ea)));
+		break;
+	case 0x7f:	/* bbr7 $nn, $nnnn */
+		branch_bit(0x80, false);
+		break;
+	case 0x80:	/* bra $nn */
+		branch(true);
+		break;
+	case 0x81:	/* sta ($nn,x) */
+		write_8(indx(), a);
+		break;
+	case 0x82:	/* nop */
+		break;
+	case 0x83:	/* nop */
+		break;
+	case 0x84:	/* sty $nn */
+		write_8(zp(), y);
+		break;
+	case 0x85:	/* sta $nn */
+		write_8(zp(), a);
+		break;
+	case 0x86:	/* stx $nn */
+		write_8(zp(), x);
+		break;
+	case 0x87:	/* smb0 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) | 0x01);
+		break;
+	case 0x88:	/* dey */
+		y = load(y - 1);
+		break;
+	case 0x89:	/* bit #$nn */
+		op_bit((uint8_t)operand);
+		break;
+	case 0x8a:	/* txa */
+		a = load(x);
+		break;
+	case 0x8b:	/* nop */
+		break;
+	case 0x8c:	/* sty $nnnn */
+		write_8(abso(), y);
+		break;
+	case 0x8d:	/* sta $nnnn */
+		write_8(abso(), a);
+		break;
+	case 0x8e:	/* stx $nnnn */
+		write_8(abso(), x);
+		break;
+	case 0x8f:	/* bbs0 $nn, $nnnn */
+		branch_bit(0x01, true);
+		break;
+	case 0x90:	/* bcc $nn */
+		branch(!(status & FLAG_CARRY));
+		break;
+	case 0x91:	/* sta ($nn),y */
+		write_8(indy(), a);
+		break;
+	case 0x92:	/* sta ($nn) */
+		write_8(ind0(), a);
+		break;
+	case 0x93:	/* nop */
+		break;
+	case 0x94:	/* sty $nn,x */
+		write_8(zpx(), y);
+		break;
+	case 0x95:	/* sta $nn,x */
+		write_8(zpx(), a);
+		break;
+	case 0x96:	/* stx $nn,y */
+		write_8(zpy(), x);
+		break;
+	case 0x97:	/* smb1 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) | 0x02);
+		break;
+	case 0x98:	/* tya */
+		a = load(y);
+		break;
+	case 0x99:	/* sta $nnnn,y */
+		write_8(absy(), a);
+		break;
+	case 0x9a:	/* txs */
+		sp = x;
+		break;
+	case 0x9b:	/* nop */
+		break;
+	case 0x9c:	/* stz $nnnn */
+		write_8(abso(), 0);
+		break;
+	case 0x9d:	/* sta $nnnn,x */
+		write_8(absx(), a);
+		break;
+	case 0x9e:	/* stz $nnnn,x */
+		write_8(absx(), 0);
+		break;
+	case 0x9f:	/* bbs1 $nn, $nnnn */
+		branch_bit(0x02, true);
+		break;
+	case 0xa0:	/* ldy #$nn */
+		y = load((uint8_t)operand);
+		break;
+	case 0xa1:	/* lda ($nn,x) */
+		a = load(read_8(indx()));
+		break;
+	case 0xa2:	/* ldx #$nn */
+		x = load((uint8_t)operand);
+		break;
+	case 0xa3:	/* nop */
+		break;
+	case 0xa4:	/* ldy $nn */
+		y = load(read_8(zp()));
+		break;
+	case 0xa5:	/* lda $nn */
+		a = load(read_8(zp()));
+		break;
+	case 0xa6:	/* ldx $nn */
+		x = load(read_8(zp()));
+		break;
+	case 0xa7:	/* smb2 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) | 0x04);
+		break;
+	case 0xa8:	/* tay */
+		y = load(a);
+		break;
+	case 0xa9:	/* lda #$nn */
+		a = load((uint8_t)operand);
+		break;
+	case 0xaa:	/* tax */
+		x = load(a);
+		break;
+	case 0xab:	/* nop */
+		break;
+	case 0xac:	/* ldy $nnnn */
+		y = load(read_8(abso()));
+		break;
+	case 0xad:	/* lda $nnnn */
+		a = load(read_8(abso()));
+		break;
+	case 0xae:	/* ldx $nnnn */
+		x = load(read_8(abso()));
+		break;
+	case 0xaf:	/* bbs2 $nn, $nnnn */
+		branch_bit(0x04, true);
+		break;
+	case 0xb0:	/* bcs $nn */
+		branch(status & FLAG_CARRY);
+		break;
+	case 0xb1:	/* lda ($nn),y */
+		a = load(read_8(indy(true)));
+		break;
+	case 0xb2:	/* lda ($nn) */
+		a = load(read_8(ind0()));
+		break;
+	case 0xb3:	/* nop */
+		break;
+	case 0xb4:	/* ldy $nn,x */
+		y = load(read_8(zpx()));
+		break;
+	case 0xb5:	/* lda $nn,x */
+		a = load(read_8(zpx()));
+		break;
+	case 0xb6:	/* ldx $nn,y */
+		x = load(read_8(zpy()));
+		break;
+	case 0xb7:	/* smb3 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) | 0x08);
+		break;
+	case 0xb8:	/* clv */
+		status &= ~FLAG_OVERFLOW;
+		break;
+	case 0xb9:	/* lda $nnnn,y */
+		a = load(read_8(absy(true)));
+		break;
+	case 0xba:	/* tsx */
+		x = load(sp);
+		break;
+	case 0xbb:	/* nop */
+		break;
+	case 0xbc:	/* ldy $nnnn,x */
+		y = load(read_8(absx(true)));
+		break;
+	case 0xbd:	/* lda $nnnn,x */
+		a = load(read_8(absx(true)));
+		break;
+	case 0xbe:	/* ldx $nnnn,y */
+		x = load(read_8(absy(true)));
+		break;
+	case 0xbf:	/* bbs3 $nn, $nnnn */
+		branch_bit(0x08, true);
+		break;
+	case 0xc0:	/* cpy #$nn */
+		op_cmp(y, (uint8_t)operand);
+		break;
+	case 0xc1:	/* cmp ($nn,x) */
+		op_cmp(a, read_8(indx()));
+		break;
+	case 0xc2:	/* nop */
+		break;
+	case 0xc3:	/* nop */
+		break;
+	case 0xc4:	/* cpy $nn */
+		op_cmp(y, read_8(zp()));
+		break;
+	case 0xc5:	/* cmp $nn */
+		op_cmp(a, read_8(zp()));
+		break;
+	case 0xc6:	/* dec $nn */
+		ea = zp();
+		write_8(ea, op_dec(read_8(ea)));
+		break;
+	case 0xc7:	/* smb4 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) | 0x10);
+		break;
+	case 0xc8:	/* iny */
+		y = load(y + 1);
+		break;
+	case 0xc9:	/* cmp #$nn */
+		op_cmp(a, (uint8_t)operand);
+		break;
+	case 0xca:	/* dex */
+		x = load(x - 1);
+		break;
+	case 0xcb:	/* wai */
+		if (!(status & FLAG_INTERRUPT)) waiting = true;
+		break;
+	case 0xcc:	/* cpy $nnnn */
+		op_cmp(y, read_8(abso()));
+		break;
+	case 0xcd:	/* cmp $nnnn */
+		op_cmp(a, read_8(abso()));
+		break;
+	case 0xce:	/* dec $nnnn */
+		ea = abso();
+		write_8(ea, op_dec(read_8(ea)));
+		break;
+	case 0xcf:	/* bbs4 $nn, $nnnn */
+		branch_bit(0x10, true);
+		break;
+	case 0xd0:	/* bne $nn */
+		branch(!(status & FLAG_ZERO));
+		break;
+	case 0xd1:	/* cmp ($nn),y */
+		op_cmp(a, read_8(indy(true)));
+		break;
+	case 0xd2:	/* cmp ($nn) */
+		op_cmp(a, read_8(ind0()));
+		break;
+	case 0xd3:	/* nop */
+		break;
+	case 0xd4:	/* nop */
+		break;
+	case 0xd5:	/* cmp $nn,x */
+		op_cmp(a, read_8(zpx()));
+		break;
+	case 0xd6:	/* dec $nn,x */
+		ea = zpx();
+		write_8(ea, op_dec(read_8(ea)));
+		break;
+	case 0xd7:	/* smb5 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) | 0x20);
+		break;
+	case 0xd8:	/* cld */
+		status &= ~FLAG_DECIMAL;
+		break;
+	case 0xd9:	/* cmp $nnnn,y */
+		op_cmp(a, read_8(absy(true)));
+		break;
+	case 0xda:	/* phx */
+		push_8(x);
+		break;
+	case 0xdb:	/* dbg */
+		break;
+	case 0xdc:	/* nop */
+		break;
+	case 0xdd:	/* cmp $nnnn,x */
+		op_cmp(a, read_8(absx(true)));
+		break;
+	case 0xde:	/* dec $nnnn,x */
+		ea = absx();
+		write_8(ea, op_dec(read_8(ea)));
+		break;
+	case 0xdf:	/* bbs5 $nn, $nnnn */
+		branch_bit(0x20, true);
+		break;
+	case 0xe0:	/* cpx #$nn */
+		op_cmp(x, (uint8_t)operand);
+		break;
+	case 0xe1:	/* sbc ($nn,x) */
+		op_sbc(read_8(indx()));
+		break;
+	case 0xe2:	/* nop */
+		break;
+	case 0xe3:	/* nop */
+		break;
+	case 0xe4:	/* cpx $nn */
+		op_cmp(x, read_8(zp()));
+		break;
+	case 0xe5:	/* sbc $nn */
+		op_sbc(read_8(zp()));
+		break;
+	case 0xe6:	/* inc $nn */
+		ea = zp();
+		write_8(ea, op_inc(read_8(ea)));
+		break;
+	case 0xe7:	/* smb6 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) | 0x40);
+		break;
+	case 0xe8:	/* inx */
+		x = load(x + 1);
+		break;
+	case 0xe9:	/* sbc #$nn */
+		op_sbc((uint8_t)operand);
+		break;
+	case 0xea:	/* nop */
+		break;
+	case 0xeb:	/* nop */
+		break;
+	case 0xec:	/* cpx $nnnn */
+		op_cmp(x, read_8(abso()));
+		break;
+	case 0xed:	/* sbc $nnnn */
+		op_sbc(read_8(abso()));
+		break;
+	case 0xee:	/* inc $nnnn */
+		ea = abso();
+		write_8(ea, op_inc(read_8(ea)));
+		break;
+	case 0xef:	/* bbs6 $nn, $nnnn */
+		branch_bit(0x40, true);
+		break;
+	case 0xf0:	/* beq $nn */
+		branch(status & FLAG_ZERO);
+		break;
+	case 0xf1:	/* sbc ($nn),y */
+		op_sbc(read_8(indy(true)));
+		break;
+	case 0xf2:	/* sbc ($nn) */
+		op_sbc(read_8(ind0()));
+		break;
+	case 0xf3:	/* nop */
+		break;
+	case 0xf4:	/* nop */
+		break;
+	case 0xf5:	/* sbc $nn,x */
+		op_sbc(read_8(zpx()));
+		break;
+	case 0xf6:	/* inc $nn,x */
+		ea = zpx();
+		write_8(ea, op_inc(read_8(ea)));
+		break;
+	case 0xf7:	/* smb7 $nn */
+		ea = zp();
+		write_8(ea, read_8(ea) | 0x80);
+		break;
+	case 0xf8:	/* sed */
+		status |= FLAG_DECIMAL;
+		break;
+	case 0xf9:	/* sbc $nnnn,y */
+		op_sbc(read_8(absy(true)));
+		break;
+	case 0xfa:	/* plx */
+		x = load(pull_8());
+		break;
+	case 0xfb:	/* nop */
+		break;
+	case 0xfc:	/* nop */
+		break;
+	case 0xfd:	/* sbc $nnnn,x */
+		op_sbc(read_8(absx(true)));
+		break;
+	case 0xfe:	/* inc $nnnn,x */
+		ea = absx();
+		write_8(ea, op_inc(read_8(ea)));
+		break;
+	case 0xff:	/* bbs7 $nn, $nnnn */
+		branch_bit(0x80, true);
+		break;
+	}
+
+	clockticks += ticktable[opcode];
+}
+
+void E64::cpu_ic::step()
+{
+	if (waiting) {
+		clockticks++;
+		return;
+	}
 
-	breakpoint = nullptr;
-	breakpoint = new bool[65536];
-	clear_breakpoints();
+	execute(fetch());
 }
 
-cpu_ic::~cpu_ic()
+/*
+ * Instructions after which the next pc isn't simply the next address, or
+ * after which an interrupt may become due.
+ */
+static inline bool ends_block(uint8_t opcode)
 {
-	delete [] breakpoint;
+	switch (opcode) {
+	case 0x10: case 0x30: case 0x50: case 0x70:	// bpl bmi bvc bvs
+	case 0x80: case 0x90: case 0xb0: case 0xd0:	// bra bcc bcs bne
+	case 0xf0:					// beq
+	case 0x4c: case 0x6c: case 0x7c:		// jmp
+	case 0x20: case 0x60: case 0x40: case 0x00:	// jsr rts rti brk
+	case 0x58: case 0x78: case 0x28: case 0xcb:	// cli sei plp wai
+		return true;
+	default:
+		return (opcode & 0x0f) == 0x0f;		// bbr bbs
+	}
 }
 
-void cpu_ic::reset()
+/*
+ * Decodes a block starting at pc. Code is only cached when it sits in
+ * memory (reading I/O would have side effects). Ram pages holding cached
+ * code are watched by the mmu, writes to them invalidate the page.
+ */
+bool E64::cpu_ic::decode_block(struct block_t *block)
 {
-	reset6502();
-	cycle_saldo = 0;
+	uint8_t page = pc >> 8;
+	uint8_t next_page = page + 1;
+
+	if (!mmu->is_memory(pc)) return false;
+
+	block->start = pc;
+	block->no_of_instructions = 0;
+
+	uint16_t address = pc;
+	bool spills = false;
+
+	do {
+		uint8_t opcode = read_8(address);
+		uint8_t length = lengthtable[opcode];
+		if (((address + length - 1) >> 8) != page) {
+			// operand bytes in the next page
+			if (!mmu->is_memory(next_page << 8)) break;
+			spills = true;
+		}
+		struct decoded_instruction_t *instruction =
+			&block->instructions[block->no_of_instructions++];
+		instruction->opcode = opcode;
+		instruction->length = length;
+		instruction->operand = 0;
+		if (length > 1) instruction->operand = read_8(address + 1);
+		if (length > 2) instruction->operand |= read_8(address + 2) << 8;
+		address += length;
+		if (ends_block(opcode)) break;
+	} while ((block->no_of_instructions < BLOCK_MAX_INSTRUCTIONS) &&
+		 ((address >> 8) == page));
+
+	if (block->no_of_instructions == 0) return false;
+
+	block->executions = BLOCK_HOT_THRESHOLD;
+	mmu->watch_code_page(page);
+	if (spills) mmu->watch_code_page(next_page);
+	block->generation[0] = page_generation[page];
+	block->generation[1] = page_generation[next_page];
+
+	return true;
 }
 
-void cpu_ic::clear_breakpoints()
+/*
+ * The block is left early when the interrupt lines change, the deadline
+ * is reached or its code is written to, so timing is exactly the same as
+ * when stepping.
+ */
+inline int E64::cpu_ic::run_block(struct block_t *block, uint16_t *old_pc)
 {
-	if (breakpoint) {
-		for (int i=0; i<65536; i++) breakpoint[i] = false;
+	struct decoded_instruction_t *instruction = block->instructions;
+	struct decoded_instruction_t *end = instruction + block->no_of_instructions;
+	code_modified = false;
+	for (;;) {
+		*old_pc = pc;
+		operand = instruction->operand;
+		pc += instruction->length;
+		execute(instruction->opcode);
+		if ((++instruction == end) || (clockticks >= *deadline) ||
+		    code_modified || interrupt_check)
+			break;
 	}
+	return (int)(instruction - block->instructions);
 }
 
-void cpu_ic::toggle_breakpoint(uint16_t address)
+bool E64::cpu_ic::run(bool single_step)
 {
-	breakpoint[address] = !breakpoint[address];
+	if (no_of_breakpoints || no_of_watchpoints) {
+		return run_loop<true>(single_step);
+	} else {
+		return run_loop<false>(single_step);
+	}
 }
 
-bool cpu_ic::run(int32_t desired_cycles, int32_t *consumed_cycles)
+template <bool debug>
+bool E64::cpu_ic::run_loop(bool single_step)
 {
-	cycle_saldo += desired_cycles;
-	
 	bool breakpoint_reached = false;
-	
-	*consumed_cycles = 0;
+
+	if (debug) {
+		watchpoint_reached = false;
+		watching = true;
+	}
 
 	/*
 	 * This loop runs always at least one instruction. If an irq or nmi is
-	 * triggered, that operation is run instead.
+	 * triggered, that operation is run instead. The deadline may move
+	 * while running, when an I/O write makes a device reschedule.
 	 */
 	do {
-		uint32_t old_clockticks6502 = clockticks6502;
-		if ((*nmi_line == false) && (old_nmi_line = true)) {
-			nmi6502();
-			*consumed_cycles += 7;
-		} else if (!(*irq_line) && !(status & FLAG_INTERRUPT)) {
-			irq6502();
-			*consumed_cycles += 7;
+		uint16_t old_pc = pc;
+		struct block_t *block;
+		if (interrupt_check && take_interrupt()) {
+			/* an nmi or irq sequence ran instead of an instruction */
+		} else if (waiting && !single_step && !(debug && is_breakpoint(pc))) {
+			/*
+			 * wai: only an interrupt ends waiting, and no device
+			 * can raise one before the next deadline. So jump
+			 * straight to it.
+			 */
+			clockticks = (*deadline > clockticks) ? *deadline : clockticks + 1;
+		} else if (debug) {
+			if (waiting) {
+				clockticks++;
+			} else {
+				watching = false;
+				uint8_t opcode = fetch();
+				watching = true;
+				execute(opcode);
+			}
+		} else if (waiting || single_step ||
+			   (engine == CPU_ENGINE_INTERPRETER) ||
+			   !(block = find_block())) {
+			step();
+		} else if (engine == CPU_ENGINE_VERIFY) {
+			verify_block(block, &old_pc);
 		} else {
-			step6502();
+			run_block(block, &old_pc);
+		}
+		if (debug) {
+			breakpoint_reached = is_breakpoint(pc) || watchpoint_reached;
+		} else if ((pc < old_pc) && !no_idle_loop[pc] && !single_step &&
+			   (*deadline > clockticks)) {
+			uint64_t available_cycles = *deadline - clockticks;
+			if (available_cycles > INT32_MAX) available_cycles = INT32_MAX;
+			if (engine == CPU_ENGINE_VERIFY) {
+				verify_idle_loop((int32_t)available_cycles);
+			} else {
+				fast_forward_idle_loop((int32_t)available_cycles);
+			}
 		}
-		*consumed_cycles += (clockticks6502 - old_clockticks6502);
-		breakpoint_reached = breakpoint[pc];
-	} while ((*consumed_cycles < cycle_saldo) && (!breakpoint_reached) && (desired_cycles > 0));
-	
-
-	old_nmi_line = nmi_line;
-	
-	cycle_saldo -= *consumed_cycles;
-	
+	} while ((clockticks < *deadline) && (!breakpoint_reached) && (!single_step));
+
+	old_nmi_line = *nmi_line;
+	watching = false;
+
 	return breakpoint_reached;
 }
 
-uint32_t cpu_ic::clock_ticks()
+void E64::cpu_ic::save_state(struct cpu_state_t *state)
+{
+	*state = { pc, sp, a, x, y, status, clockticks, waiting };
+}
+
+void E64::cpu_ic::load_state(const struct cpu_state_t *state)
+{
+	pc = state->pc;
+	sp = state->sp;
+	a = state->a;
+	x = state->x;
+	y = state->y;
+	status = state->status;
+	clockticks = state->clockticks;
+	waiting = state->waiting;
+}
+
+bool E64::cpu_ic::compare_state(const char *what, const struct cpu_state_t *expected)
+{
+	struct cpu_state_t state;
+	save_state(&state);
+	if ((state.pc == expected->pc) && (state.sp == expected->sp) &&
+	    (state.a == expected->a) && (state.x == expected->x) &&
+	    (state.y == expected->y) && (state.status == expected->status) &&
+	    (state.clockticks == expected->clockticks) &&
+	    (state.waiting == expected->waiting))
+		return true;
+
+	printf("[cpu] verify: %s differs\n", what);
+	printf("[cpu]   engine      pc:%04x sp:%02x a:%02x x:%02x y:%02x p:%02x clock:%llu\n",
+	       expected->pc, expected->sp, expected->a, expected->x,
+	       expected->y, expected->status,
+	       (unsigned long long)expected->clockticks);
+	printf("[cpu]   interpreter pc:%04x sp:%02x a:%02x x:%02x y:%02x p:%02x clock:%llu\n",
+	       state.pc, state.sp, state.a, state.x, state.y, state.status,
+	       (unsigned long long)state.clockticks);
+	return false;
+}
+
+/*
+ * The replay fetches instructions as they were in memory before the
+ * block ran, and executes as many as the block did. Only the mmu journal
+ * is touched, so memory and devices are left as the block run left them.
+ */
+void E64::cpu_ic::verify_block(struct block_t *block, uint16_t *old_pc)
+{
+	struct cpu_state_t before, after;
+	uint16_t start = pc;
+
+	save_state(&before);
+	bool interrupt_check_before = interrupt_check;
+	mmu->start_recording();
+	int no_of_instructions = run_block(block, old_pc);
+	bool recorded = mmu->stop_journal();
+	save_state(&after);
+	bool interrupt_check_after = interrupt_check;
+	bool code_modified_after = code_modified;
+
+	load_state(&before);
+	interrupt_check = interrupt_check_before;
+	mmu->start_replay();
+	for (int i=0; i<no_of_instructions; i++) {
+		uint8_t opcode = mmu->journal_peek_8(pc);
+		switch (lengthtable[opcode]) {
+		case 2:
+			operand = mmu->journal_peek_8(pc + 1);
+			break;
+		case 3:
+			operand = mmu->journal_peek_8(pc + 1) |
+				(mmu->journal_peek_8(pc + 2) << 8);
+			break;
+		}
+		pc += lengthtable[opcode];
+		execute(opcode);
+	}
+	bool accesses_match = mmu->stop_journal();
+	bool state_match = compare_state("block", &after);
+
+	if (!recorded || !accesses_match || !state_match) {
+		printf("[cpu] verify: block at $%04x, %i instruction(s), %s\n",
+		       start, no_of_instructions,
+		       !recorded ? "too many accesses to record" :
+		       !accesses_match ? "memory accesses differ" : "state differs");
+		block->no_of_instructions = 0;
+	}
+
+	load_state(&after);
+	interrupt_check = interrupt_check_after;
+	code_modified = code_modified_after;
+}
+
+/*
+ * Idle loops only touch ram, so stepping through them again from a copy
+ * of ram is safe. Afterwards ram holds the stepped result.
+ */
+void E64::cpu_ic::verify_idle_loop(int32_t available_cycles)
+{
+	struct cpu_state_t before, after;
+
+	save_state(&before);
+	memcpy(verify_ram, mmu->ram, 65536);
+	fast_forward_idle_loop(available_cycles);
+	save_state(&after);
+
+	// nothing was run
+	if (after.clockticks == before.clockticks) return;
+
+	// verify_ram gets the fast forwarded ram, ram goes back to before
+	for (int i=0; i<65536; i++) {
+		uint8_t temp = mmu->ram[i];
+		mmu->ram[i] = verify_ram[i];
+		verify_ram[i] = temp;
+	}
+
+	load_state(&before);
+	while (clockticks < after.clockticks) step();
+
+	bool state_match = compare_state("idle loop", &after);
+	bool ram_match = (memcmp(mmu->ram, verify_ram, 65536) == 0);
+	if (!state_match || !ram_match) {
+		printf("[cpu] verify: idle loop at $%04x, %s\n", before.pc,
+		       state_match ? "ram differs" : "state differs");
+		no_idle_loop[before.pc] = true;
+	}
+}
+
+/*
+ * Checks if the code at start is an idle loop: straight line code of
+ * nop, inc/dec, loads, compares, bit and stores (implied, immediate, zero
+ * page and absolute addressing only) ending in a jump or branch back to
+ * start. Additional rules make sure every complete iteration has the
+ * same effect, apart from the counters (inc/dec targets) moving on:
+ *
+ * - counters and stores must be plain ram, loads must have no side
+ *   effects (ram or rom),
+ * - no location is both stored to and loaded or counted,
+ * - the loop doesn't write to its own code,
+ * - stores and compares only use registers loaded earlier in the loop,
+ * - a loop with counters must end in an unconditional bra or jmp, a
+ *   loop without counters may end in a conditional branch on a flag
+ *   that is set inside the loop.
+ */
+bool E64::cpu_ic::analyse_idle_loop(uint16_t start, struct idle_loop_t *loop)
+{
+	uint16_t loads[IDLE_LOOP_MAX_ACCESSES];
+	uint16_t stores[IDLE_LOOP_MAX_ACCESSES];
+	int no_of_loads = 0;
+	int no_of_stores = 0;
+	bool loaded_a = false, loaded_x = false, loaded_y = false;
+	uint8_t flags_set = 0;
+
+	loop->start = start;
+	loop->no_of_instructions = 0;
+	loop->cycles = 0;
+	loop->no_of_counters = 0;
+
+	uint16_t address = start;
+
+	for (;;) {
+		if ((uint16_t)(address - start) >= IDLE_LOOP_MAX_BYTES) return false;
+
+		uint8_t opcode = read_8(address);
+		uint16_t operand = 0;
+		uint8_t length;
+
+		switch (opcode) {
+		case 0xea:	// nop
+			length = 1;
+			break;
+		case 0xa9: case 0xa2: case 0xa0:	// lda ldx ldy #
+		case 0xc9: case 0xe0: case 0xc0:	// cmp cpx cpy #
+		case 0x89:				// bit #
+			length = 2;
+			break;
+		case 0xe6: case 0xc6:			// inc dec zp
+		case 0xa5: case 0xa6: case 0xa4:	// lda ldx ldy zp
+		case 0xc5: case 0xe4: case 0xc4:	// cmp cpx cpy zp
+		case 0x24:				// bit zp
+		case 0x85: case 0x86: case 0x84: case 0x64:	// sta stx sty stz zp
+			length = 2;
+			operand = read_8(address + 1);
+			break;
+		case 0xee: case 0xce:			// inc dec abs
+		case 0xad: case 0xae: case 0xac:	// lda ldx ldy abs
+		case 0xcd: case 0xec: case 0xcc:	// cmp cpx cpy abs
+		case 0x2c:				// bit abs
+		case 0x8d: case 0x8e: case 0x8c: case 0x9c:	// sta stx sty stz abs
+		case 0x4c:				// jmp abs
+			length = 3;
+			operand = read_8(address + 1) | (read_8(address + 2) << 8);
+			break;
+		case 0x80:				// bra
+		case 0x10: case 0x30: case 0x50: case 0x70:
+		case 0x90: case 0xb0: case 0xd0: case 0xf0:
+			length = 2;
+			operand = address + 2 + (int8_t)read_8(address + 1);
+			break;
+		default:
+			return false;
+		}
+
+		loop->no_of_instructions++;
+		loop->cycles += ticktable[opcode];
+
+		bool load = false;
+		bool store = false;
+		bool conditional = false;
+		uint8_t flag = 0;
+
+		switch (opcode) {
+		case 0xea:
+			break;
+		case 0xe6: case 0xee: case 0xc6: case 0xce:
+		{
+			if (!mmu->is_ram(operand)) return false;
+			uint8_t delta = ((opcode == 0xe6) || (opcode == 0xee)) ? 1 : 0xff;
+			int i;
+			for (i=0; i<loop->no_of_counters; i++) {
+				if (loop->counter_address[i] == operand) break;
+			}
+			if (i == loop->no_of_counters) {
+				if (i == IDLE_LOOP_MAX_ACCESSES) return false;
+				loop->counter_address[i] = operand;
+				loop->counter_delta[i] = 0;
+				loop->no_of_counters++;
+			}
+			loop->counter_delta[i] += delta;
+			flags_set |= FLAG_SIGN | FLAG_ZERO;
+			break;
+		}
+		case 0xa9: case 0xa5: case 0xad:
+			loaded_a = true;
+			load = (opcode != 0xa9);
+			flags_set |= FLAG_SIGN | FLAG_ZERO;
+			break;
+		case 0xa2: case 0xa6: case 0xae:
+			loaded_x = true;
+			load = (opcode != 0xa2);
+			flags_set |= FLAG_SIGN | FLAG_ZERO;
+			break;
+		case 0xa0: case 0xa4: case 0xac:
+			loaded_y = true;
+			load = (opcode != 0xa0);
+			flags_set |= FLAG_SIGN | FLAG_ZERO;
+			break;
+		case 0xc9: case 0xc5: case 0xcd:
+			if (!loaded_a) return false;
+			load = (opcode != 0xc9);
+			flags_set |= FLAG_SIGN | FLAG_ZERO | FLAG_CARRY;
+			break;
+		case 0xe0: case 0xe4: case 0xec:
+			if (!loaded_x) return false;
+			load = (opcode != 0xe0);
+			flags_set |= FLAG_SIGN | FLAG_ZERO | FLAG_CARRY;
+			break;
+		case 0xc0: case 0xc4: case 0xcc:
+			if (!loaded_y) return false;
+			load = (opcode != 0xc0);
+			flags_set |= FLAG_SIGN | FLAG_ZERO | FLAG_CARRY;
+			break;
+		case 0x89: case 0x24: case 0x2c:
+			if (!loaded_a) return false;
+			load = (opcode != 0x89);
+			flags_set |= FLAG_SIGN | FLAG_ZERO | FLAG_OVERFLOW;
+			break;
+		case 0x85: case 0x8d:
+			if (!loaded_a) return false;
+			store = true;
+			break;
+		case 0x86: case 0x8e:
+			if (!loaded_x) return false;
+			store = true;
+			break;
+		case 0x84: case 0x8c:
+			if (!loaded_y) return false;
+			store = true;
+			break;
+		case 0x64: case 0x9c:
+			store = true;
+			break;
+		case 0x80: case 0x4c:
+			break;
+		case 0x10: case 0x30:
+			conditional = true;
+			flag = FLAG_SIGN;
+			break;
+		case 0x50: case 0x70:
+			conditional = true;
+			flag = FLAG_OVERFLOW;
+			break;
+		case 0x90: case 0xb0:
+			conditional = true;
+			flag = FLAG_CARRY;
+			break;
+		case 0xd0: case 0xf0:
+			conditional = true;
+			flag = FLAG_ZERO;
+			break;
+		}
+
+		if (load) {
+			if (!mmu->is_memory(operand)) return false;
+			if (no_of_loads == IDLE_LOOP_MAX_ACCESSES) return false;
+			loads[no_of_loads++] = operand;
+		}
+
+		if (store) {
+			if (!mmu->is_ram(operand)) return false;
+			if (no_of_stores == IDLE_LOOP_MAX_ACCESSES) return false;
+			stores[no_of_stores++] = operand;
+		}
+
+		address += length;
+
+		if ((opcode == 0x4c) || (opcode == 0x80) || conditional) {
+			// must jump back to start
+			if (operand != start) return false;
+			if (conditional) {
+				if (loop->no_of_counters) return false;
+				if (!(flags_set & flag)) return false;
+			}
+			if (opcode != 0x4c) {
+				// taken branch penalty
+				loop->cycles += ((address ^ start) & 0xff00) ? 2 : 1;
+			}
+			loop->end = address;
+			break;
+		}
+	}
+
+	uint16_t code_size = loop->end - start;
+
+	for (int i=0; i<no_of_stores; i++) {
+		if ((uint16_t)(stores[i] - start) < code_size) return false;
+		for (int j=0; j<no_of_loads; j++) {
+			if (stores[i] == loads[j]) return false;
+		}
+		for (int j=0; j<loop->no_of_counters; j++) {
+			if (stores[i] == loop->counter_address[j]) return false;
+		}
+	}
+	for (int i=0; i<loop->no_of_counters; i++) {
+		if ((uint16_t)(loop->counter_address[i] - start) < code_size) return false;
+	}
+
+	return true;
+}
+
+/*
+ * Called when pc just moved backwards. If pc is at the start of an idle
+ * loop, the number of complete iterations the run loop would still
+ * execute with the available cycles is calculated. One iteration is
+ * executed to confirm the loop is really taken, then all but one of the
+ * remaining iterations are skipped by adding their effect to the
+ * counters and the clock. A final real iteration leaves registers,
+ * flags and stored values exactly as they would have been.
+ *
+ * The available cycles end at the next scheduled device event. The loop
+ * body doesn't touch I/O, so nothing but the cpu itself can change
+ * machine state before then.
+ */
+void E64::cpu_ic::fast_forward_idle_loop(int32_t available_cycles)
+{
+	struct idle_loop_t loop;
+
+	if (!analyse_idle_loop(pc, &loop)) {
+		no_idle_loop[pc] = true;
+		return;
+	}
+
+	// interrupts that may be pending are looked at first
+	if (interrupt_check) return;
+
+	int32_t iterations = (available_cycles - 1) / (int32_t)loop.cycles;
+	if (iterations < 3) return;
+
+	for (int i=0; i<loop.no_of_instructions; i++) step();
+	if (pc != loop.start) return;
+
+	uint32_t skipped = iterations - 2;
+
+	for (int i=0; i<loop.no_of_counters; i++) {
+		uint16_t address = loop.counter_address[i];
+		write_8(address, read_8(address) + loop.counter_delta[i] * skipped);
+	}
+	clockticks += skipped * loop.cycles;
+
+	for (int i=0; i<loop.no_of_instructions; i++) step();
+}
+
+uint64_t E64::cpu_ic::clock_ticks()
 {
-	return clockticks6502;
+	return clockticks;
 }
 
-void cpu_ic::dump_stack()
+void E64::cpu_ic::dump_stack()
 {
 	printf("Stack dump\n");
 	for (int i=0; i < 10; i++) {
-		printf("%04x %02x\n", 0x100+sp+i, read6502(0x100+sp+i));
+		printf("%04x %02x\n", 0x100+sp+i, read_8(0x100+sp+i));
 	}
 }
 
-uint16_t cpu_ic::get_pc()     { return     pc; }
-uint8_t  cpu_ic::get_sp()     { return     sp; }
-uint8_t  cpu_ic::get_a()      { return      a; }
-uint8_t  cpu_ic::get_x()      { return      x; }
-uint8_t  cpu_ic::get_y()      { return      y; }
-uint8_t  cpu_ic::get_status() { return status; }
+uint16_t E64::cpu_ic::get_pc()     { return     pc; }
+uint8_t  E64::cpu_ic::get_sp()     { return     sp; }
+uint8_t  E64::cpu_ic::get_a()      { return      a; }
+uint8_t  E64::cpu_ic::get_x()      { return      x; }
+uint8_t  E64::cpu_ic::get_y()      { return      y; }
+uint8_t  E64::cpu_ic::get_status() { return status; }
 
-void cpu_ic::set_pc(uint16_t _pc)        { pc = _pc; }
-void cpu_ic::set_sp(uint8_t _sp)         { sp = _sp; }
-void cpu_ic::set_a(uint8_t _a)           { a = _a; }
-void cpu_ic::set_x(uint8_t _x)           { x = _x; }
-void cpu_ic::set_y(uint8_t _y)           { y = _y; }
-void cpu_ic::set_status(uint8_t _status) { status = _status; }
+void E64::cpu_ic::set_pc(uint16_t _pc)        { pc = _pc; }
+void E64::cpu_ic::set_sp(uint8_t _sp)         { sp = _sp; }
+void E64::cpu_ic::set_a(uint8_t _a)           { a = _a; }
+void E64::cpu_ic::set_x(uint8_t _x)           { x = _x; }
+void E64::cpu_ic::set_y(uint8_t _y)           { y = _y; }
+void E64::cpu_ic::set_status(uint8_t _status)
+{
+	status = _status;
+	interrupt_check = true;
+}
 
-int cpu_ic::disassemble(uint16_t _pc, char *buffer)
+int E64::cpu_ic::disassemble(uint16_t _pc, char *buffer)
 {
 	//char buffer[256];
-	uint8_t opcode = read6502(_pc);
+	uint8_t opcode = read_8(_pc);
 	char const *mnemonic = mnemonics[opcode];
 
 	// Test for branches, relative address. These are BRA ($80) and
@@ -123,88 +1688,41 @@ int cpu_ic::disassemble(uint16_t _pc, char *buffer)
 	strncpy(buffer, mnemonic, 256);
 
 	if (is_zp_rel) {
-		snprintf(buffer, 256, mnemonic, read6502(_pc + 1), _pc + 3 + (int8_t)read6502(_pc + 2));
+		snprintf(buffer, 256, mnemonic, read_8(_pc + 1), _pc + 3 + (int8_t)read_8(_pc + 2));
 		length = 3;
 	} else {
 		if (strstr(buffer, "%02x")) {
 			length = 2;
 			if (is_branch) {
-				snprintf(buffer, 256, mnemonic, _pc + 2 + (int8_t)read6502(_pc + 1));
+				snprintf(buffer, 256, mnemonic, _pc + 2 + (int8_t)read_8(_pc + 1));
 			} else {
-				snprintf(buffer, 256, mnemonic, read6502(_pc + 1));
+				snprintf(buffer, 256, mnemonic, read_8(_pc + 1));
 			}
 		}
 		if (strstr(buffer, "%04x")) {
 			length = 3;
-			snprintf(buffer, 256, mnemonic, read6502(_pc + 1) | read6502(_pc + 2) << 8);
+			snprintf(buffer, 256, mnemonic, read_8(_pc + 1) | read_8(_pc + 2) << 8);
 		}
 	}
 	return length;
 }
 
-int cpu_ic::disassemble(char *buffer)
+int E64::cpu_ic::disassemble(char *buffer)
 {
 	return disassemble(pc, buffer);
 }
 
-void cpu_ic::assign_irq_pin(bool *pin)
+void E64::cpu_ic::assign_irq_pin(bool *pin)
 {
 	irq_line = pin;
 }
 
-void cpu_ic::assign_nmi_pin(bool *pin)
+void E64::cpu_ic::assign_nmi_pin(bool *pin)
 {
 	nmi_line = pin;
 }
 
-
-
-
-//
-//
-//bool cpu_ic::run(int32_t desired_cycles, int32_t *consumed_cycles)
-//{
-//	cycle_saldo += desired_cycles;
-//
-//	bool done = false;
-//	bool breakpoint_reached = false;
-//
-//	*consumed_cycles = 0;
-//
-//	if ((*nmi_line == false) && (old_nmi_line = true)) {
-//		nmi6502();
-//		*consumed_cycles += 7;
-//		if (*consumed_cycles >= cycle_saldo) done = true;
-//		if (breakpoint[pc]) {
-//			breakpoint_reached = true;
-//			done = true;
-//		}
-//	} else if (!(*irq_line) && !(status & FLAG_INTERRUPT)) {
-//		irq6502();
-//		*consumed_cycles += 7;
-//		if (*consumed_cycles >= cycle_saldo) done = true;
-//		if (breakpoint[pc]) {
-//			breakpoint_reached = true;
-//			done = true;
-//		}
-//	}
-//
-//	/*
-//	 * This loop runs at least one instruction, unless a breakpoint was
-//	 * already detected at the start of an interrupt routine
-//	 */
-//	if (!done) {
-//		do {
-//			uint32_t old_clockticks6502 = clockticks6502;
-//			step6502();
-//			*consumed_cycles += (clockticks6502 - old_clockticks6502);
-//			breakpoint_reached = breakpoint[pc];
-//		} while ((*consumed_cycles < cycle_saldo) && (!breakpoint_reached) && (desired_cycles > 0));
-//	}
-//
-//	old_nmi_line = nmi_line;
-//
-//	cycle_saldo -= *consumed_cycles;
-//
-//	return breakpoint_reached;
-//}
+void E64::cpu_ic::assign_deadline(uint64_t *cycle)
+{
+	deadline = cycle;
+}
@@ -1,8 +1,23 @@
+//  cpu.hpp
+//  E64
+//
+//  Copyright © 2019-2021 elmerucr. All rights reserved.
+
+/*
+ * 65c02 core. Originally based on fake6502 by Mike Chambers with the 65c02
+ * additions of Paul Robson. All cpu state lives inside the cpu_ic instance,
+ * and instructions are dispatched from one switch statement in which
+ * addressing mode and operation are fused per opcode. Code in memory is
+ * predecoded into blocks, so run() doesn't fetch and decode the same
+ * instructions over and over again.
+ */
+
 #ifndef CPU_HPP
 #define CPU_HPP
 
 #include <cstdlib>
 #include <cstdint>
+#include "mmu.hpp"
 
 #define FLAG_CARRY     0x01
 #define FLAG_ZERO      0x02
@@ -13,27 +28,436 @@
 #define FLAG_OVERFLOW  0x40
 #define FLAG_SIGN      0x80
 
+#define DEBUG_BREAKPOINT		0x01
+#define DEBUG_WATCH_READ		0x02
+#define DEBUG_WATCH_WRITE		0x04
+
+#define BLOCK_CACHE_SIZE		4096	// power of 2
+#define BLOCK_MAX_INSTRUCTIONS		16
+#define BLOCK_HOT_THRESHOLD		4
+
+#define IDLE_LOOP_MAX_BYTES		32
+#define IDLE_LOOP_MAX_ACCESSES		8
+
+namespace E64
+{
+
+/*
+ * Execution engines, selectable at runtime. The interpreter fetches and
+ * decodes every instruction. The block engine runs predecoded blocks of
+ * hot code. The verify engine runs blocks too, but replays everything
+ * the block engine does with the interpreter in lockstep, and reports
+ * any difference (meant for testing).
+ */
+enum cpu_engine {
+	CPU_ENGINE_INTERPRETER,
+	CPU_ENGINE_BLOCKS,
+	CPU_ENGINE_VERIFY
+};
+
 class cpu_ic {
 private:
+	mmu_ic *mmu;
+
 	bool *irq_line;
 	bool old_irq_line;
 	bool *nmi_line;
 	bool old_nmi_line;
-	
-	int32_t cycle_saldo;
+
+	/*
+	 * Interrupts are only looked at when this flag is set. That is
+	 * when the interrupt controller signals a change of its output
+	 * pins, or when the interrupt disable flag gets cleared (cli,
+	 * plp, rti or from outside).
+	 */
+	bool interrupt_check;
+	inline bool take_interrupt()
+	{
+		interrupt_check = false;
+		if ((*nmi_line == false) && (old_nmi_line == true)) {
+			/* nmi is edge triggered */
+			old_nmi_line = false;
+			nmi();
+			return true;
+		} else if (!(*irq_line) && !(status & FLAG_INTERRUPT)) {
+			irq();
+			return true;
+		}
+		return false;
+	}
+
+	/* run() stops when the clock reaches this cycle */
+	uint64_t *deadline;
+
+	/* registers */
+	uint16_t pc;
+	uint8_t  sp;
+	uint8_t  a;
+	uint8_t  x;
+	uint8_t  y;
+	uint8_t  status;
+
+	uint64_t clockticks;
+	bool waiting;
+
+	static const uint8_t ticktable[256];
+
+	inline uint8_t read_8(uint16_t address)
+	{
+		return mmu->read_memory_8(address);
+	}
+	inline void write_8(uint16_t address, uint8_t value)
+	{
+		mmu->write_memory_8(address, value);
+	}
+
+	/* stack */
+	inline void push_8(uint8_t value)
+	{
+		write_8(0x100 + sp--, value);
+	}
+	inline uint8_t pull_8()
+	{
+		return read_8(0x100 + ++sp);
+	}
+	inline void push_16(uint16_t value)
+	{
+		write_8(0x100 + sp, value >> 8);
+		write_8(0x100 + ((sp - 1) & 0xff), value & 0xff);
+		sp -= 2;
+	}
+	inline uint16_t pull_16()
+	{
+		uint16_t result = read_8(0x100 + ((sp + 1) & 0xff)) |
+			(read_8(0x100 + ((sp + 2) & 0xff)) << 8);
+		sp += 2;
+		return result;
+	}
+
+	/*
+	 * Addressing modes, all return the effective address. The operand
+	 * bytes of the instruction have been fetched in advance and pc
+	 * points to the next instruction already. Modes that may cross a
+	 * page take a penalty argument. If true and a page is crossed, one
+	 * extra cycle is charged.
+	 */
+	uint16_t operand;
+
+	inline uint16_t zp() { return operand & 0xff; }
+	inline uint16_t zpx() { return (operand + x) & 0xff; }
+	inline uint16_t zpy() { return (operand + y) & 0xff; }
+	inline uint16_t abso() { return operand; }
+	inline uint16_t absx(bool penalty = false)
+	{
+		uint16_t address = operand + x;
+		if (penalty && ((operand ^ address) & 0xff00)) clockticks++;
+		return address;
+	}
+	inline uint16_t absy(bool penalty = false)
+	{
+		uint16_t address = operand + y;
+		if (penalty && ((operand ^ address) & 0xff00)) clockticks++;
+		return address;
+	}
+	/* no page boundary wraparound bug on a 65c02 */
+	inline uint16_t ind()
+	{
+		return read_8(operand) | (read_8(operand + 1) << 8);
+	}
+	inline uint16_t indx()
+	{
+		uint8_t pointer = operand + x;
+		return read_8(pointer) | (read_8((pointer + 1) & 0xff) << 8);
+	}
+	inline uint16_t indy(bool penalty = false)
+	{
+		uint8_t pointer = operand;
+		uint16_t base = read_8(pointer) | (read_8((pointer + 1) & 0xff) << 8);
+		uint16_t address = base + y;
+		if (penalty && ((base ^ address) & 0xff00)) clockticks++;
+		return address;
+	}
+	inline uint16_t ind0()
+	{
+		uint8_t pointer = operand;
+		return read_8(pointer) | (read_8((pointer + 1) & 0xff) << 8);
+	}
+	inline uint16_t ainx()
+	{
+		uint16_t pointer = operand + x;
+		return read_8(pointer) | (read_8(pointer + 1) << 8);
+	}
+
+	/* operations */
+	inline uint8_t load(uint8_t value)
+	{
+		status = (status & ~(FLAG_ZERO | FLAG_SIGN)) |
+			(value ? 0 : FLAG_ZERO) | (value & FLAG_SIGN);
+		return value;
+	}
+	inline void set_carry(bool carry)
+	{
+		status = carry ? (status | FLAG_CARRY) : (status & ~FLAG_CARRY);
+	}
+	inline void op_ora(uint8_t value) { a = load(a | value); }
+	inline void op_and(uint8_t value) { a = load(a & value); }
+	inline void op_eor(uint8_t value) { a = load(a ^ value); }
+	void op_adc(uint8_t value);
+	void op_sbc(uint8_t value);
+	inline void op_cmp(uint8_t reg, uint8_t value)
+	{
+		set_carry(reg >= value);
+		load(reg - value);
+	}
+	inline void op_bit(uint8_t value)
+	{
+		status = (a & value) ? (status & ~FLAG_ZERO) : (status | FLAG_ZERO);
+		status = (status & 0x3f) | (value & 0xc0);
+	}
+	inline uint8_t op_asl(uint8_t value)
+	{
+		set_carry(value & 0x80);
+		return load(value << 1);
+	}
+	inline uint8_t op_lsr(uint8_t value)
+	{
+		set_carry(value & 0x01);
+		return load(value >> 1);
+	}
+	inline uint8_t op_rol(uint8_t value)
+	{
+		uint8_t result = (value << 1) | (status & FLAG_CARRY);
+		set_carry(value & 0x80);
+		return load(result);
+	}
+	inline uint8_t op_ror(uint8_t value)
+	{
+		uint8_t result = (value >> 1) | ((status & FLAG_CARRY) << 7);
+		set_carry(value & 0x01);
+		return load(result);
+	}
+	inline uint8_t op_inc(uint8_t value) { return load(value + 1); }
+	inline uint8_t op_dec(uint8_t value) { return load(value - 1); }
+	inline uint8_t op_tsb(uint8_t value)
+	{
+		status = (a & value) ? (status & ~FLAG_ZERO) : (status | FLAG_ZERO);
+		return value | a;
+	}
+	inline uint8_t op_trb(uint8_t value)
+	{
+		status = (a & value) ? (status & ~FLAG_ZERO) : (status | FLAG_ZERO);
+		return value & ~a;
+	}
+
+	/* branches cost one extra cycle if taken, two if crossing a page */
+	inline void branch(bool condition)
+	{
+		int8_t offset = operand;
+		if (condition) {
+			uint16_t old_pc = pc;
+			pc += offset;
+			clockticks += ((old_pc ^ pc) & 0xff00) ? 2 : 1;
+		}
+	}
+	inline void branch_bit(uint8_t mask, bool set)
+	{
+		uint8_t address = operand;
+		int8_t offset = operand >> 8;
+		if (((read_8(address) & mask) != 0) == set) {
+			uint16_t old_pc = pc;
+			pc += offset;
+			clockticks += ((old_pc ^ pc) & 0xff00) ? 2 : 1;
+		}
+	}
+	inline void jsr(uint16_t address)
+	{
+		push_16(pc - 1);
+		pc = address;
+	}
+	void brk();
+
+	void nmi();
+	void irq();
+
+	/*
+	 * Instruction length in bytes, opcode included. The undocumented
+	 * multi byte nops are 1 byte implied ops here, as in fake6502.
+	 */
+	static const uint8_t lengthtable[256];
+
+	/*
+	 * Executes one instruction of which the operand has been fetched
+	 * and pc has been advanced already.
+	 */
+	inline void execute(uint8_t opcode);
+
+	/* fetches an instruction and its operand, advances pc */
+	inline uint8_t fetch()
+	{
+		uint8_t opcode = read_8(pc);
+		switch (lengthtable[opcode]) {
+		case 2:
+			operand = read_8(pc + 1);
+			break;
+		case 3:
+			operand = read_8(pc + 1) | (read_8(pc + 2) << 8);
+			break;
+		}
+		pc += lengthtable[opcode];
+		return opcode;
+	}
+
+	/* fetches and executes exactly one instruction */
+	void step();
+
+	/*
+	 * Block cache. Straight line code up to and including the first
+	 * instruction that may change the flow of control (or the
+	 * interrupt flag) is predecoded into a block, keyed by its start
+	 * address. Blocks don't start instructions beyond the page they
+	 * start in, so only the page itself and, for operand bytes, the
+	 * next page are involved. Every page has a generation number that
+	 * moves on when the page is written to. A block is only valid as
+	 * long as the generations of both its pages are unchanged.
+	 */
+	struct decoded_instruction_t {
+		uint8_t  opcode;
+		uint8_t  length;
+		uint16_t operand;
+	};
+	struct block_t {
+		uint16_t start;
+		uint8_t  no_of_instructions;	// 0 means empty
+		uint8_t  executions;		// counts up to BLOCK_HOT_THRESHOLD
+		uint32_t generation[2];
+		struct decoded_instruction_t instructions[BLOCK_MAX_INSTRUCTIONS];
+	};
+	struct block_t *blocks;
+	uint32_t page_generation[256];
+	bool code_modified;
+	void flush_blocks();
+	bool decode_block(struct block_t *block);
+
+	/*
+	 * Returns the block at pc, or nullptr if there is none (yet).
+	 * Code starting at a new address is stepped through the first
+	 * few times, only hot code is worth decoding.
+	 */
+	inline struct block_t *find_block()
+	{
+		struct block_t *block = &blocks[pc & (BLOCK_CACHE_SIZE - 1)];
+		if (block->start != pc) {
+			block->start = pc;
+			block->no_of_instructions = 0;
+			block->executions = 0;
+		} else if (block->no_of_instructions &&
+			   (block->generation[0] == page_generation[pc >> 8]) &&
+			   (block->generation[1] == page_generation[((pc >> 8) + 1) & 0xff])) {
+			return block;
+		}
+		if (block->executions < BLOCK_HOT_THRESHOLD) {
+			block->executions++;
+			return nullptr;
+		}
+		return decode_block(block) ? block : nullptr;
+	}
+
+	enum cpu_engine engine;
+
+	/*
+	 * Runs (part of) a block, returns the number of instructions
+	 * executed. old_pc is set to the pc of the last one.
+	 */
+	inline int run_block(struct block_t *block, uint16_t *old_pc);
+
+	/*
+	 * Verify engine. A block run is recorded by the mmu journal, then
+	 * replayed by the interpreter from the same starting state, with
+	 * reads answered from the journal. Registers, clock and all
+	 * memory accesses must match. An idle loop fast forward is
+	 * compared with stepping through it, starting from a copy of ram.
+	 * A difference is reported, and the block is dropped from the
+	 * cache or the loop is no longer fast forwarded.
+	 */
+	struct cpu_state_t {
+		uint16_t pc;
+		uint8_t  sp;
+		uint8_t  a;
+		uint8_t  x;
+		uint8_t  y;
+		uint8_t  status;
+		uint64_t clockticks;
+		bool     waiting;
+	};
+	void save_state(struct cpu_state_t *state);
+	void load_state(const struct cpu_state_t *state);
+	bool compare_state(const char *what, const struct cpu_state_t *expected);
+	uint8_t *verify_ram;
+	void verify_block(struct block_t *block, uint16_t *old_pc);
+	void verify_idle_loop(int32_t available_cycles);
+
+	/*
+	 * Breakpoints and watchpoints. Flags per address, plus a sorted
+	 * list of addresses for each kind. As long as nothing is armed,
+	 * run() uses a loop without any checks (and the mmu doesn't divert
+	 * accesses). Otherwise the cpu is interpreted instruction by
+	 * instruction, without blocks and idle loops, so no access goes
+	 * unnoticed. Instruction fetches don't count as reads.
+	 */
+	uint8_t  *debug_flags;
+	uint16_t *breakpoints;
+	int no_of_breakpoints;
+	uint16_t *watchpoints;
+	int no_of_watchpoints;
+	bool watching;
+	bool watchpoint_reached;
+	uint16_t watchpoint_address;
+	bool watchpoint_write;
+
+	template <bool debug> bool run_loop(bool single_step);
+
+	/*
+	 * Idle loops. A short loop that only touches ram and jumps back
+	 * to itself (e.g. the rom main loop incrementing a counter while
+	 * waiting for interrupts) is fast forwarded instead of being
+	 * executed instruction by instruction. Loop starts that were
+	 * analysed and rejected are remembered in no_idle_loop, so
+	 * ordinary loops pay for the analysis only once.
+	 */
+	struct idle_loop_t {
+		uint16_t start;
+		uint16_t end;
+		uint8_t  no_of_instructions;
+		uint32_t cycles;	// per iteration
+		uint8_t  no_of_counters;
+		uint16_t counter_address[IDLE_LOOP_MAX_ACCESSES];
+		uint8_t  counter_delta[IDLE_LOOP_MAX_ACCESSES];
+	};
+	bool *no_idle_loop;
+	bool analyse_idle_loop(uint16_t start, struct idle_loop_t *loop);
+	void fast_forward_idle_loop(int32_t available_cycles);
 public:
-	cpu_ic();
+	cpu_ic(mmu_ic *unit);
 	~cpu_ic();
-	
-	bool *breakpoint;
 
 	void reset();
 
 	/*
-	 * Basic run function. When run with 0 cycles, it runs 1 instruction
-	 * minimal. The return value contains the realized number of cycles.
+	 * Called by the mmu when a ram page holding predecoded code is
+	 * written to.
 	 */
-	bool run(int32_t desired_cycles, int32_t *consumed_cycles);
+	inline void invalidate_code_page(uint8_t page)
+	{
+		page_generation[page]++;
+		code_modified = true;
+	}
+
+	/*
+	 * Basic run function. Runs until the clock reaches the deadline, or
+	 * exactly one instruction when single stepping. The return value
+	 * tells if a breakpoint or watchpoint was reached.
+	 */
+	bool run(bool single_step);
 
 	uint16_t get_pc();
 	uint8_t  get_sp();
@@ -41,12 +465,20 @@ public:
 	uint8_t  get_x();
 	uint8_t  get_y();
 	uint8_t  get_status();
-	
+
 	void assign_irq_pin(bool *pin);
 	void assign_nmi_pin(bool *pin);
-	
-	inline bool get_irq_line() { return irq_line; }
-	inline bool get_nmi_line() { return nmi_line; }
+	void assign_deadline(uint64_t *cycle);
+
+	/* to be set by the interrupt controller when its outputs change */
+	inline bool *interrupt_change_flag() { return &interrupt_check; }
+
+	void set_engine(enum cpu_engine e);
+	inline enum cpu_engine get_engine() { return engine; }
+	const char *engine_name();
+
+	inline bool get_irq_line() { return *irq_line; }
+	inline bool get_nmi_line() { return *nmi_line; }
 	inline bool get_old_nmi_line() { return old_nmi_line; }
 
 	void set_pc(uint16_t _pc);
@@ -58,12 +490,44 @@ public:
 
 	int disassemble(char *buffer);
 	int disassemble(uint16_t _pc, char *buffer);
-	
+
+	inline bool is_breakpoint(uint16_t address)
+	{
+		return debug_flags[address] & DEBUG_BREAKPOINT;
+	}
 	void toggle_breakpoint(uint16_t address);
 	void clear_breakpoints();
+	inline int get_no_of_breakpoints() { return no_of_breakpoints; }
+	inline uint16_t get_breakpoint(int i) { return breakpoints[i]; }
+
+	/* flags is DEBUG_WATCH_READ, DEBUG_WATCH_WRITE or both */
+	inline uint8_t get_watchpoint(uint16_t address)
+	{
+		return debug_flags[address] & (DEBUG_WATCH_READ | DEBUG_WATCH_WRITE);
+	}
+	void toggle_watchpoint(uint16_t address, uint8_t flags);
+	void clear_watchpoints();
+	inline int get_no_of_watchpoints() { return no_of_watchpoints; }
+	inline uint16_t get_watchpoint_address(int i) { return watchpoints[i]; }
+
+	/* reports if the last run stopped on a watchpoint, and where */
+	bool watchpoint_hit(uint16_t *address, bool *write);
+
+	/* called by the mmu for accesses to pages with watchpoints */
+	inline void memory_access(uint16_t address, bool write)
+	{
+		if (watching && (debug_flags[address] &
+				 (write ? DEBUG_WATCH_WRITE : DEBUG_WATCH_READ))) {
+			watchpoint_reached = true;
+			watchpoint_address = address;
+			watchpoint_write = write;
+		}
+	}
 
 	void dump_stack();
-	uint32_t clock_ticks();
+	uint64_t clock_ticks();
 };
 
+}
+
 #endif
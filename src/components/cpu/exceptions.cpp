@@ -7,10 +7,11 @@
 
 E64::exceptions_ic::exceptions_ic()
 {
-    for(int i=0; i<8; i++) irq_input_pins[i] = true;
-    next_available_device = 0;
-    nmi_output_pin = true;
-	update_status();
+	irq_pulled = 0;
+	next_available_device = 0;
+	change_flag = nullptr;
+	irq_output_pin = true;
+	nmi_output_pin = true;
 }
 
 uint8_t E64::exceptions_ic::connect_device()
@@ -21,27 +22,8 @@ uint8_t E64::exceptions_ic::connect_device()
 	return return_value;
 }
 
-void E64::exceptions_ic::update_status()
+void E64::exceptions_ic::assign_change_flag(bool *flag)
 {
-	bool result =	(!(irq_input_pins[0])) |
-			(!(irq_input_pins[1])) |
-			(!(irq_input_pins[2])) |
-			(!(irq_input_pins[3])) |
-			(!(irq_input_pins[4])) |
-			(!(irq_input_pins[5])) |
-			(!(irq_input_pins[6])) |
-			(!(irq_input_pins[7])) ;
-	irq_output_pin = !result;
-}
-
-void E64::exceptions_ic::pull(uint8_t device)
-{
-	irq_input_pins[device & 0x7] = false;
-	update_status();
-}
-
-void E64::exceptions_ic::release(uint8_t device)
-{
-	irq_input_pins[device & 0x7] = true;
-	update_status();
+	change_flag = flag;
+	if (change_flag) *change_flag = true;
 }
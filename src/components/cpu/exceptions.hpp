@@ -11,18 +11,44 @@
 namespace E64
 {
 
+/*
+ * Interrupt controller. Pulled irq inputs are kept as a bitmask (one bit
+ * per device). When the output pins change, the flag assigned with
+ * assign_change_flag() is set, so the cpu only needs to look at its
+ * interrupt lines after being told they changed.
+ */
 class exceptions_ic {
 private:
 	uint8_t next_available_device;
-	void update_status();
+	uint8_t irq_pulled;
+	bool *change_flag;
+	inline void update_status()
+	{
+		bool old_irq_output_pin = irq_output_pin;
+		irq_output_pin = (irq_pulled == 0);
+		if (change_flag && (irq_output_pin != old_irq_output_pin))
+			*change_flag = true;
+	}
 public:
-	bool irq_input_pins[8];
 	exceptions_ic();
 	bool irq_output_pin;
 	bool nmi_output_pin;
 	uint8_t connect_device();
-	void pull(uint8_t device);
-	void release(uint8_t device);
+	void assign_change_flag(bool *flag);
+	inline bool irq_input_pin(uint8_t device)
+	{
+		return !(irq_pulled & (1 << (device & 0x7)));
+	}
+	inline void pull(uint8_t device)
+	{
+		irq_pulled |= 1 << (device & 0x7);
+		update_status();
+	}
+	inline void release(uint8_t device)
+	{
+		irq_pulled &= ~(1 << (device & 0x7));
+		update_status();
+	}
 };
 
 }
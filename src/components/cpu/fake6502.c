@@ -1,250 +0,0 @@
-/* Fake6502 CPU emulator core v1.1 *******************
- * (c)2011 Mike Chambers (miker00lz@gmail.com)       *
- *****************************************************
- * v1.1 - Small bugfix in BIT opcode, but it was the *
- *        difference between a few games in my NES   *
- *        emulator working and being broken!         *
- *        I went through the rest carefully again    *
- *        after fixing it just to make sure I didn't *
- *        have any other typos! (Dec. 17, 2011)      *
- *                                                   *
- * v1.0 - First release (Nov. 24, 2011)              *
- *****************************************************
- * LICENSE: This source code is released into the    *
- * public domain, but if you use it please do give   *
- * credit. I put a lot of effort into writing this!  *
- *                                                   *
- *****************************************************
- * Fake6502 is a MOS Technology 6502 CPU emulation   *
- * engine in C. It was written as part of a Nintendo *
- * Entertainment System emulator I've been writing.  *
- *                                                   *
- * A couple important things to know about are two   *
- * defines in the code. One is "UNDOCUMENTED" which, *
- * when defined, allows Fake6502 to compile with     *
- * full support for the more predictable             *
- * undocumented instructions of the 6502. If it is   *
- * undefined, undocumented opcodes just act as NOPs. *
- *                                                   *
- * The other define is "NES_CPU", which causes the   *
- * code to compile without support for binary-coded  *
- * decimal (BCD) support for the ADC and SBC         *
- * opcodes. The Ricoh 2A03 CPU in the NES does not   *
- * support BCD, but is otherwise identical to the    *
- * standard MOS 6502. (Note that this define is      *
- * enabled in this file if you haven't changed it    *
- * yourself. If you're not emulating a NES, you      *
- * should comment it out.)                           *
- *                                                   *
- * If you do discover an error in timing accuracy,   *
- * or operation in general please e-mail me at the   *
- * address above so that I can fix it. Thank you!    *
- *                                                   *
- *****************************************************
- * Usage:                                            *
- *                                                   *
- * Fake6502 requires you to provide two external     *
- * functions:                                        *
- *                                                   *
- * uint8_t read6502(uint16_t address)                *
- * void write6502(uint16_t address, uint8_t value)   *
- *                                                   *
- * You may optionally pass Fake6502 the pointer to a *
- * function which you want to be called after every  *
- * emulated instruction. This function should be a   *
- * void with no parameters expected to be passed to  *
- * it.                                               *
- *                                                   *
- * This can be very useful. For example, in a NES    *
- * emulator, you check the number of clock ticks     *
- * that have passed so you can know when to handle   *
- * APU events.                                       *
- *                                                   *
- * To pass Fake6502 this pointer, use the            *
- * hookexternal(void *funcptr) function provided.    *
- *                                                   *
- * To disable the hook later, pass NULL to it.       *
- *****************************************************
- * Useful functions in this emulator:                *
- *                                                   *
- * void reset6502()                                  *
- *   - Call this once before you begin execution.    *
- *                                                   *
- * void exec6502(uint32_t tickcount)                 *
- *   - Execute 6502 code up to the next specified    *
- *     count of clock ticks.                         *
- *                                                   *
- * void step6502()                                   *
- *   - Execute a single instrution.                  *
- *                                                   *
- * void irq6502()                                    *
- *   - Trigger a hardware IRQ in the 6502 core.      *
- *                                                   *
- * void nmi6502()                                    *
- *   - Trigger an NMI in the 6502 core.              *
- *                                                   *
- * void hookexternal(void *funcptr)                  *
- *   - Pass a pointer to a void function taking no   *
- *     parameters. This will cause Fake6502 to call  *
- *     that function once after each emulated        *
- *     instruction.                                  *
- *                                                   *
- *****************************************************
- * Useful variables in this emulator:                *
- *                                                   *
- * uint32_t clockticks6502                           *
- *   - A running total of the emulated cycle count.  *
- *                                                   *
- * uint32_t instructions                             *
- *   - A running total of the total emulated         *
- *     instruction count. This is not related to     *
- *     clock cycle timing.                           *
- *                                                   *
- *****************************************************/
-
-#include <stdio.h>
-#include <stdint.h>
-#include "fake6502.h"
-//#include "../debugger.h"
-
-//6502 defines
-#define UNDOCUMENTED //when this is defined, undocumented opcodes are handled.
-                     //otherwise, they're simply treated as NOPs.
-
-//#define NES_CPU      //when this is defined, the binary-coded decimal (BCD)
-                     //status flag is not honored by ADC and SBC. the 2A03
-                     //CPU in the Nintendo Entertainment System does not
-                     //support BCD operation.
-
-#define FLAG_CARRY     0x01
-#define FLAG_ZERO      0x02
-#define FLAG_INTERRUPT 0x04
-#define FLAG_DECIMAL   0x08
-#define FLAG_BREAK     0x10
-#define FLAG_CONSTANT  0x20
-#define FLAG_OVERFLOW  0x40
-#define FLAG_SIGN      0x80
-
-#define BASE_STACK     0x100
-
-
-//6502 CPU registers
-uint16_t pc;
-uint8_t sp, a, x, y, status;
-
-
-//helper variables
-uint32_t instructions = 0; //keep track of total instructions executed
-uint32_t clockticks6502 = 0, clockgoal6502 = 0;
-uint16_t oldpc, ea, reladdr, value, result;
-uint8_t opcode, oldstatus;
-
-uint8_t penaltyop, penaltyaddr;
-uint8_t waiting = 0;
-
-#include "support.h"
-#include "modes.h"
-
-static void (*addrtable[256])();
-static void (*optable[256])();
-
-static uint16_t getvalue() {
-    if (addrtable[opcode] == acc) return((uint16_t)a);
-        else return((uint16_t)read6502(ea));
-}
-
-__attribute__((unused)) static uint16_t getvalue16() {
-    return((uint16_t)read6502(ea) | ((uint16_t)read6502(ea+1) << 8));
-}
-
-static void putvalue(uint16_t saveval) {
-    if (addrtable[opcode] == acc) a = (uint8_t)(saveval & 0x00FF);
-        else write6502(ea, (saveval & 0x00FF));
-}
-
-#include "instructions.h"
-#include "65c02.h"
-#include "tables.h"
-
-void nmi6502() {
-    push16(pc);
-    push8(status);
-    status |= FLAG_INTERRUPT;
-    pc = (uint16_t)read6502(0xFFFA) | ((uint16_t)read6502(0xFFFB) << 8);
-	waiting = 0;
-}
-
-void irq6502() {
-    push16(pc);
-    push8(status & ~FLAG_BREAK);
-    status |= FLAG_INTERRUPT;
-    pc = (uint16_t)read6502(0xFFFE) | ((uint16_t)read6502(0xFFFF) << 8);
-	waiting = 0;
-}
-
-uint8_t callexternal = 0;
-void (*loopexternal)();
-
-void exec6502(uint32_t tickcount) {
-	if (waiting) {
-		clockticks6502 += tickcount;
-		clockgoal6502 = clockticks6502;
-		return;
-    }
-
-    clockgoal6502 += tickcount;
-   
-    while (clockticks6502 < clockgoal6502) {
-        opcode = read6502(pc++);
-        status |= FLAG_CONSTANT;
-
-        penaltyop = 0;
-        penaltyaddr = 0;
-
-        (*addrtable[opcode])();
-        (*optable[opcode])();
-        clockticks6502 += ticktable[opcode];
-        if (penaltyop && penaltyaddr) clockticks6502++;
-
-        instructions++;
-
-        if (callexternal) (*loopexternal)();
-    }
-}
-
-void step6502() {
-	if (waiting) {
-		++clockticks6502;
-		clockgoal6502 = clockticks6502;
-		return;
-	}
-
-    opcode = read6502(pc++);
-    status |= FLAG_CONSTANT;
-
-    penaltyop = 0;
-    penaltyaddr = 0;
-
-    (*addrtable[opcode])();
-    (*optable[opcode])();
-    clockticks6502 += ticktable[opcode];
-    if (penaltyop && penaltyaddr) clockticks6502++;
-    clockgoal6502 = clockticks6502;
-
-    instructions++;
-
-    if (callexternal) (*loopexternal)();
-}
-
-void hookexternal(void *funcptr) {
-    if (funcptr != (void *)NULL) {
-        loopexternal = funcptr;
-        callexternal = 1;
-    } else callexternal = 0;
-}
-
-//  Fixes from http://6502.org/tutorials/65c02opcodes.html
-//
-//  65C02 Cycle Count differences.
-//        ADC/SBC work differently in decimal mode.
-//        The wraparound fixes may not be required.
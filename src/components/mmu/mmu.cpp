@@ -9,76 +9,207 @@
 #include "common.hpp"
 #include "rom.hpp"
 
+/*
+ * I/O handlers
+ */
+static uint8_t vicv_read(uint16_t address)
+{
+	return vicv.read_byte(address & 0x01);
+}
+
+static void vicv_write(uint16_t address, uint8_t value)
+{
+	vicv.write_byte(address & 0x01, value);
+}
+
+static uint8_t blit_read(uint16_t address)
+{
+	return machine.blitter->io_read_8(address & 0xff);
+}
+
+static void blit_write(uint16_t address, uint8_t value)
+{
+	machine.blitter->io_write_8(address & 0xff, value);
+}
+
+static uint8_t blit_memory_read(uint16_t address)
+{
+	return machine.blitter->indirect_memory_read_8(address & 0xff);
+}
+
+static void blit_memory_write(uint16_t address, uint8_t value)
+{
+	machine.blitter->indirect_memory_write_8(address & 0xff, value);
+}
+
+static uint8_t blit_descriptor_read(uint16_t address)
+{
+	return machine.blitter->descriptor_read_8(address & 0x07ff);
+}
+
+static void blit_descriptor_write(uint16_t address, uint8_t value)
+{
+	machine.blitter->descriptor_write_8(address & 0x07ff, value);
+}
+
+static uint8_t timer_read(uint16_t address)
+{
+	return machine.timer->read_byte(address & 0xff);
+}
+
+static void timer_write(uint16_t address, uint8_t value)
+{
+	machine.sync();
+	machine.timer->write_byte(address & 0xff, value);
+}
+
+static uint8_t sid_read(uint16_t address)
+{
+	return machine.sids->read_byte(address & 0xff);
+}
+
+static void sid_write(uint16_t address, uint8_t value)
+{
+	machine.sync();
+	machine.sids->write_byte(address & 0xff, value);
+}
+
+static uint8_t cia_read(uint16_t address)
+{
+	return machine.cia->read_byte(address & 0xff);
+}
+
+static void cia_write(uint16_t address, uint8_t value)
+{
+	machine.cia->write_byte(address & 0xff, value);
+}
+
+static uint8_t watched_read(uint16_t address)
+{
+	return machine.mmu->watched_read_8(address);
+}
+
+static void watched_write(uint16_t address, uint8_t value)
+{
+	machine.mmu->watched_write_8(address, value);
+}
+
+static uint8_t journal_read(uint16_t address)
+{
+	return machine.mmu->journal_read_8(address);
+}
+
+static void journal_write(uint16_t address, uint8_t value)
+{
+	machine.mmu->journal_write_8(address, value);
+}
+
 E64::mmu_ic::mmu_ic()
 {
 	ram = new uint8_t[RAM_SIZE * sizeof(uint8_t)];
+	journal_mode = JOURNAL_OFF;
+	journal_length = 0;
+	journal_position = 0;
+	journal_mismatch = false;
+	build_page_tables();
 	reset();
 }
 
 E64::mmu_ic::~mmu_ic()
 {
-	delete ram;
+	delete [] ram;
 	ram = nullptr;
 }
 
-void E64::mmu_ic::reset()
+void E64::mmu_ic::map_io(uint8_t page, io_read_handler r, io_write_handler w)
 {
-	// fill alternating blocks with 0x00 and 0xff (hard reset)
-	for (int i=0; i < RAM_SIZE; i++)
-		ram[i] = (i & 64) ? 0xff : 0x00;
-
-	// if available, update rom image
-	update_rom_image();
+	mapped_read_pages[page] = nullptr;
+	mapped_write_pages[page] = nullptr;
+	mapped_io_read[page] = r;
+	mapped_io_write[page] = w;
 }
 
-uint8_t E64::mmu_ic::read_memory_8(uint16_t address)
-{
-	uint16_t page = address >> 8;
-	
-	if (page == IO_VICV) {
-		return vicv.read_byte(address & 0x01);
-	} else if (page == IO_BLIT) {
-		return machine.blitter->io_read_8(address & 0xff);
-	} else if (page == IO_BLIT_MEMORY) {
-		return machine.blitter->indirect_memory_read_8(address & 0xff);
-	} else if (page == IO_SID_PAGE) {
-		return machine.sids->read_byte(address & 0xff);
-	} else if (page == IO_TIMER_PAGE) {
-		return machine.timer->read_byte(address & 0xff);
-	} else if (page == IO_CIA_PAGE) {
-		return machine.cia->read_byte(address & 0xff);
-	} else if ((page & IO_ROM_PAGE) == IO_ROM_PAGE) {
-		return current_rom_image[address & 0x1fff];
-	} else if ((page & IO_BLIT_DESCRIPTOR) == IO_BLIT_DESCRIPTOR) {
-		return machine.blitter->descriptor_read_8(address & 0x07ff);
-	} else {
-		return ram[address & 0xffff];
+void E64::mmu_ic::build_page_tables()
+{
+	for (int page=0; page<256; page++) {
+		mapped_read_pages[page] = &ram[page << 8];
+		mapped_write_pages[page] = &ram[page << 8];
+		mapped_io_read[page] = nullptr;
+		mapped_io_write[page] = nullptr;
+		code_page[page] = false;
+		read_watches[page] = 0;
+		write_watches[page] = 0;
+	}
+	
+	/*
+	 * Blit descriptors occupy 0xd800-0xdfff. Note that writes to
+	 * 0xf800-0xffff also end up in the descriptors, while all other
+	 * writes to the rom area go to the ram underneath.
+	 */
+	for (int page=0; page<256; page++) {
+		if ((page & IO_BLIT_DESCRIPTOR) == IO_BLIT_DESCRIPTOR)
+			map_io(page, blit_descriptor_read, blit_descriptor_write);
+	}
+	
+	/* rom reads, 8k image mirrored over 0xe000-0xffff */
+	for (int page=IO_ROM_PAGE; page<256; page++) {
+		mapped_read_pages[page] = &current_rom_image[(page << 8) & 0x1fff];
 	}
+	
+	map_io(IO_VICV, vicv_read, vicv_write);
+	map_io(IO_BLIT, blit_read, blit_write);
+	map_io(IO_BLIT_MEMORY, blit_memory_read, blit_memory_write);
+	map_io(IO_TIMER_PAGE, timer_read, timer_write);
+	map_io(IO_SID_PAGE, sid_read, sid_write);
+	map_io(IO_CIA_PAGE, cia_read, cia_write);
+	
+	for (int page=0; page<256; page++) update_page(page);
 }
 
-void E64::mmu_ic::write_memory_8(uint16_t address, uint8_t value)
+void E64::mmu_ic::update_page(uint8_t page)
 {
-	uint16_t page = address >> 8;
+	if (journal_mode != JOURNAL_OFF) {
+		read_pages[page] = nullptr;
+		write_pages[page] = nullptr;
+		io_read[page] = journal_read;
+		io_write[page] = journal_write;
+		return;
+	}
+	
+	if (read_watches[page]) {
+		read_pages[page] = nullptr;
+		io_read[page] = watched_read;
+	} else {
+		read_pages[page] = mapped_read_pages[page];
+		io_read[page] = mapped_io_read[page];
+	}
 	
-	if (page == IO_VICV) {
-		vicv.write_byte(address & 0x01, value & 0xff);
-	} else if (page == IO_BLIT) {
-		machine.blitter->io_write_8(address & 0xff, value & 0xff);
-	} else if (page == IO_BLIT_MEMORY) {
-		machine.blitter->indirect_memory_write_8(address & 0xff, value & 0xff);
-	} else if (page == IO_SID_PAGE) {
-		machine.sids->write_byte(address & 0xff, value & 0xff);
-	} else if (page == IO_TIMER_PAGE) {
-		machine.timer->write_byte(address & 0xff, value & 0xff);
-	} else if (page == IO_CIA_PAGE) {
-		machine.cia->write_byte(address & 0xff, value & 0xff);
-	} else if ((page & IO_BLIT_DESCRIPTOR) == IO_BLIT_DESCRIPTOR) {
-		machine.blitter->descriptor_write_8(address & 0x07ff, value);
+	if (code_page[page] || write_watches[page]) {
+		write_pages[page] = nullptr;
+		io_write[page] = watched_write;
 	} else {
-		ram[address & 0xffff] = value & 0xff;
+		write_pages[page] = mapped_write_pages[page];
+		io_write[page] = mapped_io_write[page];
 	}
 }
 
+void E64::mmu_ic::reset()
+{
+	for (int page=0; page<256; page++) {
+		if (code_page[page]) {
+			code_page[page] = false;
+			update_page(page);
+		}
+	}
+	
+	// fill alternating blocks with 0x00 and 0xff (hard reset)
+	for (int i=0; i < RAM_SIZE; i++)
+		ram[i] = (i & 64) ? 0xff : 0x00;
+
+	// if available, update rom image
+	update_rom_image();
+}
+
 void E64::mmu_ic::update_rom_image()
 {
 	FILE *f = fopen(host.settings.path_to_rom, "r");
@@ -94,3 +225,156 @@ void E64::mmu_ic::update_rom_image()
 		for(int i=0; i<8192; i++) current_rom_image[i] = rom[i];
 	}
 }
+
+void E64::mmu_ic::watch_code_page(uint8_t page)
+{
+	if (is_ram(page << 8) && !code_page[page]) {
+		code_page[page] = true;
+		update_page(page);
+	}
+}
+
+void E64::mmu_ic::watch_address(uint16_t address, bool write, bool on)
+{
+	uint16_t *watches = write ? &write_watches[address >> 8] :
+		&read_watches[address >> 8];
+	
+	if (on) {
+		(*watches)++;
+	} else if (*watches) {
+		(*watches)--;
+	}
+	update_page(address >> 8);
+}
+
+uint8_t E64::mmu_ic::watched_read_8(uint16_t address)
+{
+	uint8_t page = address >> 8;
+	
+	machine.cpu->memory_access(address, false);
+	
+	return mapped_read_pages[page] ?
+		mapped_read_pages[page][address & 0xff] :
+		mapped_io_read[page](address);
+}
+
+void E64::mmu_ic::watched_write_8(uint16_t address, uint8_t value)
+{
+	uint8_t page = address >> 8;
+	
+	if (code_page[page]) {
+		code_page[page] = false;
+		update_page(page);
+		machine.cpu->invalidate_code_page(page);
+	}
+	
+	if (write_watches[page]) machine.cpu->memory_access(address, true);
+	
+	if (mapped_write_pages[page]) {
+		mapped_write_pages[page][address & 0xff] = value;
+	} else {
+		mapped_io_write[page](address, value);
+	}
+}
+
+void E64::mmu_ic::set_journal_mode(enum journal_mode mode)
+{
+	journal_mode = mode;
+	for (int page=0; page<256; page++) update_page(page);
+}
+
+void E64::mmu_ic::start_recording()
+{
+	journal_length = 0;
+	journal_mismatch = false;
+	set_journal_mode(JOURNAL_RECORD);
+}
+
+void E64::mmu_ic::start_replay()
+{
+	journal_position = 0;
+	set_journal_mode(JOURNAL_REPLAY);
+}
+
+bool E64::mmu_ic::stop_journal()
+{
+	bool match = !journal_mismatch;
+	if (journal_mode == JOURNAL_REPLAY)
+		match = match && (journal_position == journal_length);
+	set_journal_mode(JOURNAL_OFF);
+	return match;
+}
+
+uint8_t E64::mmu_ic::journal_peek_8(uint16_t address)
+{
+	for (int i=0; i<journal_length; i++) {
+		if (journal[i].write && (journal[i].address == address))
+			return journal[i].old_value;
+	}
+	return peek_8(address);
+}
+
+/*
+ * While recording, accesses take the route they would take with the
+ * journal off. A recording that doesn't fit counts as a mismatch.
+ */
+uint8_t E64::mmu_ic::journal_read_8(uint16_t address)
+{
+	uint8_t page = address >> 8;
+	
+	if (journal_mode == JOURNAL_REPLAY) {
+		if ((journal_position < journal_length) &&
+		    !journal[journal_position].write &&
+		    (journal[journal_position].address == address))
+			return journal[journal_position++].value;
+		journal_mismatch = true;
+		return peek_8(address);
+	}
+	
+	uint8_t value;
+	if (read_watches[page]) {
+		value = watched_read_8(address);
+	} else if (mapped_read_pages[page]) {
+		value = mapped_read_pages[page][address & 0xff];
+	} else {
+		value = mapped_io_read[page](address);
+	}
+	
+	if (journal_length < JOURNAL_SIZE) {
+		journal[journal_length++] = { address, value, 0, false };
+	} else {
+		journal_mismatch = true;
+	}
+	return value;
+}
+
+void E64::mmu_ic::journal_write_8(uint16_t address, uint8_t value)
+{
+	uint8_t page = address >> 8;
+	
+	if (journal_mode == JOURNAL_REPLAY) {
+		if ((journal_position < journal_length) &&
+		    journal[journal_position].write &&
+		    (journal[journal_position].address == address) &&
+		    (journal[journal_position].value == value)) {
+			journal_position++;
+		} else {
+			journal_mismatch = true;
+		}
+		return;
+	}
+	
+	if (journal_length < JOURNAL_SIZE) {
+		journal[journal_length++] = { address, value, peek_8(address), true };
+	} else {
+		journal_mismatch = true;
+	}
+	
+	if (code_page[page] || write_watches[page]) {
+		watched_write_8(address, value);
+	} else if (mapped_write_pages[page]) {
+		mapped_write_pages[page][address & 0xff] = value;
+	} else {
+		mapped_io_write[page](address, value);
+	}
+}
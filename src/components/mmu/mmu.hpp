@@ -25,10 +25,74 @@
 
 #define IO_ROM_PAGE		0xe0
 
+#define JOURNAL_SIZE		256
+
 namespace E64
 {
 
+enum journal_mode {
+	JOURNAL_OFF,
+	JOURNAL_RECORD,
+	JOURNAL_REPLAY
+};
+
+/*
+ * I/O handlers receive the full 16 bit address, each device masks out the
+ * bits it needs.
+ */
+typedef uint8_t (*io_read_handler)(uint16_t address);
+typedef void    (*io_write_handler)(uint16_t address, uint8_t value);
+
 class mmu_ic {
+private:
+	/*
+	 * Page tables, one entry per 256 byte page. If a read or write
+	 * entry points to memory (ram or rom), the access is served
+	 * directly. A nullptr means the page is mapped to an I/O device,
+	 * or is being watched, and the corresponding handler is called.
+	 */
+	uint8_t *read_pages[256];
+	uint8_t *write_pages[256];
+	io_read_handler  io_read[256];
+	io_write_handler io_write[256];
+	
+	/*
+	 * The memory map itself. The page tables above equal these,
+	 * except for pages that are watched.
+	 */
+	uint8_t *mapped_read_pages[256];
+	uint8_t *mapped_write_pages[256];
+	io_read_handler  mapped_io_read[256];
+	io_write_handler mapped_io_write[256];
+	
+	/* watched pages */
+	bool code_page[256];
+	uint16_t read_watches[256];
+	uint16_t write_watches[256];
+	
+	/*
+	 * Access journal, for the cpu verify engine. While recording,
+	 * every access is served as usual and logged. While replaying,
+	 * reads are answered from the log and writes are only compared
+	 * with it, so the same code can run a second time without side
+	 * effects. An access that differs from the log is a mismatch.
+	 */
+	struct journal_entry_t {
+		uint16_t address;
+		uint8_t  value;
+		uint8_t  old_value;	// writes only
+		bool     write;
+	};
+	struct journal_entry_t journal[JOURNAL_SIZE];
+	int journal_length;
+	int journal_position;
+	bool journal_mismatch;
+	enum journal_mode journal_mode;
+	void set_journal_mode(enum journal_mode mode);
+	
+	void map_io(uint8_t page, io_read_handler r, io_write_handler w);
+	void build_page_tables();
+	void update_page(uint8_t page);
 public:
 	mmu_ic();
 	~mmu_ic();
@@ -38,10 +102,76 @@ public:
 	
 	void reset();
 	
-	uint8_t read_memory_8(uint16_t address);
-	void write_memory_8(uint16_t address, uint8_t value);
+	inline uint8_t read_memory_8(uint16_t address)
+	{
+		uint8_t *page = read_pages[address >> 8];
+		return page ? page[address & 0xff] : io_read[address >> 8](address);
+	}
+	
+	inline void write_memory_8(uint16_t address, uint8_t value)
+	{
+		uint8_t *page = write_pages[address >> 8];
+		if (page) {
+			page[address & 0xff] = value;
+		} else {
+			io_write[address >> 8](address, value);
+		}
+	}
+	
+	/* plain ram, no I/O device and no rom behind this address */
+	inline bool is_ram(uint16_t address)
+	{
+		return mapped_read_pages[address >> 8] == &ram[address & 0xff00];
+	}
+	
+	/* ram or rom, reading has no side effects */
+	inline bool is_memory(uint16_t address)
+	{
+		return mapped_read_pages[address >> 8] != nullptr;
+	}
+	
+	/* reads ram or rom without side effects, I/O reads as 0 */
+	inline uint8_t peek_8(uint16_t address)
+	{
+		uint8_t *page = mapped_read_pages[address >> 8];
+		return page ? page[address & 0xff] : 0;
+	}
 	
 	void update_rom_image();
+	
+	/*
+	 * Code pages. The cpu keeps predecoded code and must know when it
+	 * changes. The first write to a watched ram page unwatches the
+	 * page and tells the cpu to invalidate it. Pages that aren't plain
+	 * ram are left alone, rom doesn't change while running.
+	 */
+	void watch_code_page(uint8_t page);
+	
+	/*
+	 * Watchpoints. Accesses to a page with watchpoints are reported
+	 * to the cpu, other pages are served at full speed.
+	 */
+	void watch_address(uint16_t address, bool write, bool on);
+	
+	/* accesses to watched pages end up here */
+	uint8_t watched_read_8(uint16_t address);
+	void watched_write_8(uint16_t address, uint8_t value);
+	
+	/*
+	 * start_recording() clears the journal, start_replay() goes back
+	 * to its start. stop_journal() returns false if a replay didn't
+	 * match the recording, or didn't use all of it.
+	 */
+	void start_recording();
+	void start_replay();
+	bool stop_journal();
+	
+	/* like peek_8, but as it was before the recorded writes */
+	uint8_t journal_peek_8(uint16_t address);
+	
+	/* all accesses end up here while the journal is on */
+	uint8_t journal_read_8(uint16_t address);
+	void journal_write_8(uint16_t address, uint8_t value);
 };
 
 }
@@ -0,0 +1,131 @@
+//  scheduler.hpp
+//  E64
+//
+//  Copyright © 2021 elmerucr. All rights reserved.
+//
+//  Central event scheduler. The time base is the cpu clock (in cycles
+//  since power on). Every device that has a future event (vicv vblank,
+//  timer expiry, cia keyboard interval) keeps exactly one absolute
+//  deadline here. The cpu runs straight through to the earliest one,
+//  after which the machine brings all devices up to date.
+//
+//  Deadlines are kept in a small binary min heap indexed by event, so a
+//  device can move its deadline (earlier or later) at any moment.
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <cstdint>
+
+#define SCHEDULER_NEVER	UINT64_MAX
+
+namespace E64
+{
+
+enum scheduler_event {
+	SCHEDULER_VICV,
+	SCHEDULER_TIMER,
+	SCHEDULER_CIA,
+	SCHEDULER_NO_OF_EVENTS
+};
+
+class scheduler_t
+{
+private:
+	uint64_t deadlines[SCHEDULER_NO_OF_EVENTS];
+
+	// heap of events ordered by deadline, and position of each event
+	int heap[SCHEDULER_NO_OF_EVENTS];
+	int position[SCHEDULER_NO_OF_EVENTS];
+
+	inline void swap(int i, int j)
+	{
+		int temp = heap[i];
+		heap[i] = heap[j];
+		heap[j] = temp;
+		position[heap[i]] = i;
+		position[heap[j]] = j;
+	}
+
+	inline void sift_up(int i)
+	{
+		while (i > 0) {
+			int parent = (i - 1) / 2;
+			if (deadlines[heap[parent]] <= deadlines[heap[i]]) break;
+			swap(i, parent);
+			i = parent;
+		}
+	}
+
+	inline void sift_down(int i)
+	{
+		for (;;) {
+			int smallest = i;
+			int left = (2 * i) + 1;
+			int right = left + 1;
+			if ((left < SCHEDULER_NO_OF_EVENTS) &&
+			    (deadlines[heap[left]] < deadlines[heap[smallest]]))
+				smallest = left;
+			if ((right < SCHEDULER_NO_OF_EVENTS) &&
+			    (deadlines[heap[right]] < deadlines[heap[smallest]]))
+				smallest = right;
+			if (smallest == i) break;
+			swap(i, smallest);
+			i = smallest;
+		}
+	}
+public:
+	/*
+	 * Current time as seen by the devices. Updated by the machine each
+	 * time the devices have been brought up to date with the cpu.
+	 */
+	uint64_t current_cycle;
+
+	/*
+	 * Earliest deadline of all events. The cpu holds a pointer to this
+	 * value and stops running as soon as its clock reaches it.
+	 */
+	uint64_t next_deadline;
+
+	scheduler_t()
+	{
+		current_cycle = 0;
+		for (int i=0; i<SCHEDULER_NO_OF_EVENTS; i++) {
+			deadlines[i] = SCHEDULER_NEVER;
+			heap[i] = i;
+			position[i] = i;
+		}
+		next_deadline = SCHEDULER_NEVER;
+	}
+
+	inline void schedule(enum scheduler_event event, uint64_t deadline)
+	{
+		uint64_t old_deadline = deadlines[event];
+		deadlines[event] = deadline;
+		if (deadline < old_deadline) {
+			sift_up(position[event]);
+		} else {
+			sift_down(position[event]);
+		}
+		next_deadline = deadlines[heap[0]];
+	}
+
+	inline void schedule_in(enum scheduler_event event, uint64_t cycles)
+	{
+		schedule(event, current_cycle + cycles);
+	}
+
+	inline void cancel(enum scheduler_event event)
+	{
+		schedule(event, SCHEDULER_NEVER);
+	}
+
+	inline uint64_t deadline(enum scheduler_event event)
+	{
+		return deadlines[event];
+	}
+};
+
+}
+
+#endif
@@ -6,9 +6,10 @@
 #include "timer.hpp"
 #include "common.hpp"
 
-E64::timer_ic::timer_ic(exceptions_ic *unit)
+E64::timer_ic::timer_ic(exceptions_ic *unit, scheduler_t *s)
 {
 	exceptions = unit;
+	scheduler = s;
 	irq_number = exceptions->connect_device();
 }
 
@@ -28,6 +29,8 @@ void E64::timer_ic::reset()
 	}
 	
 	exceptions->release(irq_number);
+	
+	schedule_next_event();
 }
 
 void E64::timer_ic::run(uint32_t number_of_cycles)
@@ -41,6 +44,27 @@ void E64::timer_ic::run(uint32_t number_of_cycles)
 			registers[0] |= (0b1 << i);
 		}
 	}
+	
+	schedule_next_event();
+}
+
+void E64::timer_ic::schedule_next_event()
+{
+	uint64_t cycles = SCHEDULER_NEVER;
+	
+	for (int i=0; i<8; i++) {
+		if (registers[1] & (0b1 << i)) {
+			uint32_t remaining = (timers[i].counter < timers[i].clock_interval) ?
+				timers[i].clock_interval - timers[i].counter : 1;
+			if (remaining < cycles) cycles = remaining;
+		}
+	}
+	
+	if (cycles == SCHEDULER_NEVER) {
+		scheduler->cancel(SCHEDULER_TIMER);
+	} else {
+		scheduler->schedule_in(SCHEDULER_TIMER, cycles);
+	}
 }
 
 uint32_t E64::timer_ic::bpm_to_clock_interval(uint16_t bpm)
@@ -90,6 +114,7 @@ void E64::timer_ic::write_byte(uint8_t address, uint8_t byte)
 				}
 			}
 			registers[0x01] = byte;
+			schedule_next_event();
 			break;
 		}
 		default:
@@ -44,6 +44,7 @@
 
 #include <cstdint>
 #include "exceptions.hpp"
+#include "scheduler.hpp"
 
 namespace E64
 {
@@ -66,8 +67,12 @@ private:
 	uint32_t bpm_to_clock_interval(uint16_t bpm);
 	
 	exceptions_ic *exceptions;
+	scheduler_t *scheduler;
+	
+	// registers the earliest expiry of all enabled timers
+	void schedule_next_event();
 public:
-	timer_ic(exceptions_ic *unit);
+	timer_ic(exceptions_ic *unit, scheduler_t *s);
 	void reset();
 	
 	uint8_t irq_number;
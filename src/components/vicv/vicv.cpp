@@ -9,57 +9,71 @@
 #include "vicv.hpp"
 #include "common.hpp"
 
+#define VICV_VBLANK_START	((VICV_PIXELS_PER_SCANLINE+VICV_PIXELS_HBLANK)*VICV_SCANLINES)
+#define VICV_FRAME_END		((VICV_PIXELS_PER_SCANLINE+VICV_PIXELS_HBLANK)*(VICV_SCANLINES+VICV_SCANLINES_VBLANK))
+
 E64::vicv_ic::vicv_ic()
 {
 	frame_is_done = false;
-	cycle_clock = dot_clock = 0;
+	cycle_clock = 0;
 }
 
 void E64::vicv_ic::reset()
 {
 	registers[0] = 0;
 	registers[1] = 0;
+	
+	schedule_next_event();
 }
 
 void E64::vicv_ic::run(uint32_t cycles)
 {
 	/*
-	 * y_pos needs initialization otherwise compiler complains.
-	 * Chosen for bogus 0xff value => probably in initialized data
-	 * section. Seems to be fastest when looking at cpu usage.
+	 * Nothing happens in between the start of vblank and the end of
+	 * the frame, so the clock moves from one event to the next.
 	 */
-	uint32_t y_pos = 0xff;
-	
-	uint32_t x_pos;
-
 	while (cycles > 0) {
-		y_pos = cycle_clock /
-			(VICV_PIXELS_PER_SCANLINE+VICV_PIXELS_HBLANK);
-		x_pos = cycle_clock -
-			(y_pos * (VICV_PIXELS_PER_SCANLINE+VICV_PIXELS_HBLANK));
-		bool hblank = (x_pos >= VICV_PIXELS_PER_SCANLINE);
-		bool vblank = cycle_clock>=((VICV_PIXELS_PER_SCANLINE+VICV_PIXELS_HBLANK)*VICV_SCANLINES);
-		bool blank = hblank || vblank;
-
-		if (!blank) dot_clock++;	// progress dot clock if pixel was sent (!blank)
-
-		cycle_clock++;
-        
+		uint32_t next_event = (cycle_clock < VICV_VBLANK_START) ?
+			VICV_VBLANK_START : VICV_FRAME_END;
+		uint32_t step = next_event - cycle_clock;
+		if (step > cycles) step = cycles;
+		
+		cycle_clock += step;
+		cycles -= step;
+		
 		switch (cycle_clock) {
-			case (VICV_PIXELS_PER_SCANLINE+VICV_PIXELS_HBLANK)*VICV_SCANLINES:
+			case VICV_VBLANK_START:
 				// start of vblank
 				if (!machine.paused) {
 					registers[0] = 0b00000001;
 					machine.exceptions->pull(irq_number);
 				}
 				break;
-			case (VICV_PIXELS_PER_SCANLINE+VICV_PIXELS_HBLANK)*(VICV_SCANLINES+VICV_SCANLINES_VBLANK):
+			case VICV_FRAME_END:
 				// end of vblank
-				cycle_clock = dot_clock = 0;
+				cycle_clock = 0;
 				frame_is_done = true;
 				break;
 		}
-	cycles--;
+	}
+	
+	schedule_next_event();
+}
+
+void E64::vicv_ic::schedule_next_event()
+{
+	/*
+	 * As long as a finished frame hasn't been picked up, the machine
+	 * should stop running immediately.
+	 */
+	if (frame_is_done) {
+		machine.scheduler->schedule_in(SCHEDULER_VICV, 0);
+	} else if (cycle_clock < VICV_VBLANK_START) {
+		machine.scheduler->schedule_in(SCHEDULER_VICV,
+					       VICV_VBLANK_START - cycle_clock);
+	} else {
+		machine.scheduler->schedule_in(SCHEDULER_VICV,
+					       VICV_FRAME_END - cycle_clock);
 	}
 }
 
@@ -23,10 +23,12 @@ class vicv_ic
 {
 private:
 	uint32_t cycle_clock;	// measures all cycles
-	uint32_t dot_clock;	// measures only cycles that wrote a pixel
 	
 	// this will be flagged if a frame is completely done
 	bool frame_is_done;
+	
+	// registers the next vblank or end of frame with the scheduler
+	void schedule_next_event();
 public:
 	vicv_ic();
 	
@@ -38,8 +40,10 @@ public:
 	
 	inline bool frame_done() {
 		bool result = frame_is_done;
-		if (frame_is_done)
+		if (frame_is_done) {
 			frame_is_done = false;
+			schedule_next_event();
+		}
 		return result;
 	}
 
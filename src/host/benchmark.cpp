@@ -0,0 +1,93 @@
+//  benchmark.cpp
+//  E64
+//
+//  Copyright © 2021 elmerucr. All rights reserved.
+
+#include <cstdio>
+#include "benchmark.hpp"
+#include "common.hpp"
+
+static const char *subsystem_names[E64::BENCH_NO_OF_SUBSYSTEMS] = {
+	"vicv",
+	"cpu",
+	"cia",
+	"timer",
+	"sids",
+	"blitter",
+	"hud",
+	"video"
+};
+
+/*
+ * FNV-1a, used to fingerprint machine state at the end of a run. Equal
+ * checksums between two builds mean identical emulation results.
+ */
+static uint32_t fnv1a(uint32_t hash, const uint8_t *data, size_t size)
+{
+	for (size_t i=0; i<size; i++) {
+		hash ^= data[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+E64::benchmark_t::benchmark_t()
+{
+	active = false;
+	frames_to_run = frames_done = 0;
+	start_cpu_ticks = 0;
+	for (int i=0; i<BENCH_NO_OF_SUBSYSTEMS; i++) subsystem_time[i] = 0;
+}
+
+void E64::benchmark_t::start(uint32_t no_of_frames)
+{
+	printf("[benchmark] running %u frames headless\n", no_of_frames);
+	
+	active = true;
+	frames_to_run = no_of_frames;
+	frames_done = 0;
+	for (int i=0; i<BENCH_NO_OF_SUBSYSTEMS; i++) subsystem_time[i] = 0;
+	
+	start_cpu_ticks = machine.cpu->clock_ticks();
+	start_moment = lap_moment = std::chrono::steady_clock::now();
+}
+
+bool E64::benchmark_t::frame_done()
+{
+	frames_done++;
+	return frames_done >= frames_to_run;
+}
+
+void E64::benchmark_t::report()
+{
+	double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>
+		(std::chrono::steady_clock::now() - start_moment).count() / 1e9;
+	uint64_t cpu_ticks = machine.cpu->clock_ticks() - start_cpu_ticks;
+	
+	printf("[benchmark] %u frames in %.3f s\n", frames_done, seconds);
+	printf("[benchmark] %.2f frames/s (%.2fx realtime)\n",
+	       frames_done / seconds, (frames_done / seconds) / FPS);
+	printf("[benchmark] %llu cpu cycles, %.2f MHz emulated\n",
+	       (unsigned long long)cpu_ticks, cpu_ticks / seconds / 1e6);
+	
+	uint32_t hash = 2166136261;
+	hash = fnv1a(hash, machine.mmu->ram, RAM_SIZE);
+	hash = fnv1a(hash, (uint8_t *)machine.blitter->frontbuffer,
+		     VICV_TOTAL_PIXELS * sizeof(uint16_t));
+	hash = fnv1a(hash, (uint8_t *)hud.blitter->frontbuffer,
+		     VICV_TOTAL_PIXELS * sizeof(uint16_t));
+	printf("[benchmark] state checksum %08x\n", hash);
+	
+	int64_t total = 0;
+	for (int i=0; i<BENCH_NO_OF_SUBSYSTEMS; i++) total += subsystem_time[i];
+	
+	printf("[benchmark] subsystem    time (ms)   share\n");
+	for (int i=0; i<BENCH_NO_OF_SUBSYSTEMS; i++) {
+		printf("[benchmark] %-10s %11.2f  %5.1f%%\n",
+		       subsystem_names[i],
+		       subsystem_time[i] / 1e6,
+		       total ? (100.0 * subsystem_time[i]) / total : 0.0);
+	}
+	
+	active = false;
+}
@@ -0,0 +1,71 @@
+//  benchmark.hpp
+//  E64
+//
+//  Copyright © 2021 elmerucr. All rights reserved.
+
+/*
+ * Headless benchmark harness. When active, the main loop runs without
+ * window, audio device or frame pacing for a fixed number of frames. Time
+ * spent in the different subsystems is accumulated with lap(): each call
+ * charges the time since the previous lap to the given subsystem.
+ */
+
+#include <cstdint>
+#include <chrono>
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+namespace E64
+{
+
+enum benchmark_subsystem {
+	BENCH_VICV,
+	BENCH_CPU,
+	BENCH_CIA,
+	BENCH_TIMER,
+	BENCH_SIDS,
+	BENCH_BLITTER,
+	BENCH_HUD,
+	BENCH_VIDEO,
+	BENCH_NO_OF_SUBSYSTEMS
+};
+
+class benchmark_t
+{
+private:
+	std::chrono::time_point<std::chrono::steady_clock> start_moment;
+	std::chrono::time_point<std::chrono::steady_clock> lap_moment;
+	
+	int64_t subsystem_time[BENCH_NO_OF_SUBSYSTEMS];	// in nanoseconds
+	
+	uint32_t frames_to_run;
+	uint32_t frames_done;
+	uint64_t start_cpu_ticks;
+public:
+	benchmark_t();
+	
+	bool active;
+	
+	void start(uint32_t no_of_frames);
+	
+	// returns true when the requested number of frames has been run
+	bool frame_done();
+	
+	void report();
+	
+	inline void lap(enum benchmark_subsystem subsystem)
+	{
+		if (active) {
+			std::chrono::time_point<std::chrono::steady_clock> now =
+				std::chrono::steady_clock::now();
+			subsystem_time[subsystem] +=
+				std::chrono::duration_cast<std::chrono::nanoseconds>(now - lap_moment).count();
+			lap_moment = now;
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,245 @@
+//  blend.cpp
+//  E64
+//
+//  Copyright © 2021 elmerucr. All rights reserved.
+
+#include <cstdio>
+#include "video.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BLEND_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * With the formula of alpha_blend(), an opaque source (alpha 0xf) gives
+ * exactly the source, and a transparent source (alpha 0x0) leaves the
+ * destination as it is. All kernels copy or skip those, and only blend
+ * translucent pixels.
+ */
+#define ALPHA_OPAQUE(color)		(((color) & 0xf000) == 0xf000)
+#define ALPHA_TRANSPARENT(color)	(((color) & 0xf000) == 0x0000)
+
+/*
+ * Scalar kernels
+ */
+void alpha_blend_span_scalar(uint16_t *destination, const uint16_t *source, int n)
+{
+	while (n--) {
+		uint16_t color = *source++;
+		if (ALPHA_OPAQUE(color)) {
+			*destination = color;
+		} else if (!ALPHA_TRANSPARENT(color)) {
+			alpha_blend(destination, &color);
+		}
+		destination++;
+	}
+}
+
+void alpha_blend_color_scalar(uint16_t *destination, uint16_t color, int n)
+{
+	if (ALPHA_OPAQUE(color)) {
+		while (n--) *destination++ = color;
+	} else if (!ALPHA_TRANSPARENT(color)) {
+		while (n--) alpha_blend(destination++, &color);
+	}
+}
+
+#ifdef BLEND_X86
+
+/*
+ * Same arithmetic as alpha_blend(), on 16 bit lanes. With a_src in 1-16
+ * and channels in 0-15, no intermediate result exceeds 0xff, so lanes
+ * don't overflow.
+ */
+static inline __m128i blend_8(__m128i destination, __m128i source)
+{
+	const __m128i nibble = _mm_set1_epi16(0x000f);
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i sixteen = _mm_set1_epi16(16);
+	const __m128i max = _mm_set1_epi16(256);
+
+	__m128i a_src = _mm_srli_epi16(source, 12);
+	__m128i a_src_inv = _mm_sub_epi16(sixteen, a_src);
+	a_src = _mm_add_epi16(a_src, one);
+
+	__m128i a_dest = _mm_srli_epi16(destination, 12);
+	a_dest = _mm_srli_epi16(_mm_sub_epi16(max,
+		_mm_mullo_epi16(a_src_inv, _mm_sub_epi16(sixteen, a_dest))), 4);
+
+	__m128i r = _mm_srli_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(a_src, _mm_and_si128(_mm_srli_epi16(source, 8), nibble)),
+		_mm_mullo_epi16(a_src_inv, _mm_and_si128(_mm_srli_epi16(destination, 8), nibble))), 4);
+	__m128i g = _mm_srli_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(a_src, _mm_and_si128(_mm_srli_epi16(source, 4), nibble)),
+		_mm_mullo_epi16(a_src_inv, _mm_and_si128(_mm_srli_epi16(destination, 4), nibble))), 4);
+	__m128i b = _mm_srli_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(a_src, _mm_and_si128(source, nibble)),
+		_mm_mullo_epi16(a_src_inv, _mm_and_si128(destination, nibble))), 4);
+
+	return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(a_dest, 12), _mm_slli_epi16(r, 8)),
+			    _mm_or_si128(_mm_slli_epi16(g, 4), b));
+}
+
+/*
+ * Groups of 8 pixels that are all opaque are copied, groups that are all
+ * transparent are skipped, and the others are blended.
+ */
+static void alpha_blend_span_sse2(uint16_t *destination, const uint16_t *source, int n)
+{
+	const __m128i alpha = _mm_set1_epi16((short)0xf000);
+	const __m128i zero = _mm_setzero_si128();
+	
+	for (; n >= 8; n -= 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)source);
+		__m128i a = _mm_and_si128(s, alpha);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(a, alpha)) == 0xffff) {
+			_mm_storeu_si128((__m128i *)destination, s);
+		} else if (_mm_movemask_epi8(_mm_cmpeq_epi16(a, zero)) != 0xffff) {
+			__m128i d = _mm_loadu_si128((__m128i *)destination);
+			_mm_storeu_si128((__m128i *)destination, blend_8(d, s));
+		}
+		destination += 8;
+		source += 8;
+	}
+	alpha_blend_span_scalar(destination, source, n);
+}
+
+static void alpha_blend_color_sse2(uint16_t *destination, uint16_t color, int n)
+{
+	if (ALPHA_TRANSPARENT(color)) return;
+	
+	__m128i s = _mm_set1_epi16(color);
+	if (ALPHA_OPAQUE(color)) {
+		for (; n >= 8; n -= 8) {
+			_mm_storeu_si128((__m128i *)destination, s);
+			destination += 8;
+		}
+	} else {
+		for (; n >= 8; n -= 8) {
+			__m128i d = _mm_loadu_si128((__m128i *)destination);
+			_mm_storeu_si128((__m128i *)destination, blend_8(d, s));
+			destination += 8;
+		}
+	}
+	alpha_blend_color_scalar(destination, color, n);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend_16(__m256i destination, __m256i source)
+{
+	const __m256i nibble = _mm256_set1_epi16(0x000f);
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i sixteen = _mm256_set1_epi16(16);
+	const __m256i max = _mm256_set1_epi16(256);
+
+	__m256i a_src = _mm256_srli_epi16(source, 12);
+	__m256i a_src_inv = _mm256_sub_epi16(sixteen, a_src);
+	a_src = _mm256_add_epi16(a_src, one);
+
+	__m256i a_dest = _mm256_srli_epi16(destination, 12);
+	a_dest = _mm256_srli_epi16(_mm256_sub_epi16(max,
+		_mm256_mullo_epi16(a_src_inv, _mm256_sub_epi16(sixteen, a_dest))), 4);
+
+	__m256i r = _mm256_srli_epi16(_mm256_add_epi16(
+		_mm256_mullo_epi16(a_src, _mm256_and_si256(_mm256_srli_epi16(source, 8), nibble)),
+		_mm256_mullo_epi16(a_src_inv, _mm256_and_si256(_mm256_srli_epi16(destination, 8), nibble))), 4);
+	__m256i g = _mm256_srli_epi16(_mm256_add_epi16(
+		_mm256_mullo_epi16(a_src, _mm256_and_si256(_mm256_srli_epi16(source, 4), nibble)),
+		_mm256_mullo_epi16(a_src_inv, _mm256_and_si256(_mm256_srli_epi16(destination, 4), nibble))), 4);
+	__m256i b = _mm256_srli_epi16(_mm256_add_epi16(
+		_mm256_mullo_epi16(a_src, _mm256_and_si256(source, nibble)),
+		_mm256_mullo_epi16(a_src_inv, _mm256_and_si256(destination, nibble))), 4);
+
+	return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(a_dest, 12), _mm256_slli_epi16(r, 8)),
+			       _mm256_or_si256(_mm256_slli_epi16(g, 4), b));
+}
+
+__attribute__((target("avx2")))
+static void alpha_blend_span_avx2(uint16_t *destination, const uint16_t *source, int n)
+{
+	const __m256i alpha = _mm256_set1_epi16((short)0xf000);
+	const __m256i zero = _mm256_setzero_si256();
+	
+	for (; n >= 16; n -= 16) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)source);
+		__m256i a = _mm256_and_si256(s, alpha);
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(a, alpha)) == -1) {
+			_mm256_storeu_si256((__m256i *)destination, s);
+		} else if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(a, zero)) != -1) {
+			__m256i d = _mm256_loadu_si256((__m256i *)destination);
+			_mm256_storeu_si256((__m256i *)destination, blend_16(d, s));
+		}
+		destination += 16;
+		source += 16;
+	}
+	alpha_blend_span_sse2(destination, source, n);
+}
+
+__attribute__((target("avx2")))
+static void alpha_blend_color_avx2(uint16_t *destination, uint16_t color, int n)
+{
+	if (ALPHA_TRANSPARENT(color)) return;
+	
+	__m256i s = _mm256_set1_epi16(color);
+	if (ALPHA_OPAQUE(color)) {
+		for (; n >= 16; n -= 16) {
+			_mm256_storeu_si256((__m256i *)destination, s);
+			destination += 16;
+		}
+	} else {
+		for (; n >= 16; n -= 16) {
+			__m256i d = _mm256_loadu_si256((__m256i *)destination);
+			_mm256_storeu_si256((__m256i *)destination, blend_16(d, s));
+			destination += 16;
+		}
+	}
+	alpha_blend_color_sse2(destination, color, n);
+}
+
+#endif
+
+/*
+ * Both pointers start out at a resolver, which picks the kernels on first
+ * use. This way blending works from any constructor, whatever the order
+ * of static initialisation.
+ */
+static void select_kernels();
+
+static void alpha_blend_span_resolve(uint16_t *destination, const uint16_t *source, int n)
+{
+	select_kernels();
+	alpha_blend_span(destination, source, n);
+}
+
+static void alpha_blend_color_resolve(uint16_t *destination, uint16_t color, int n)
+{
+	select_kernels();
+	alpha_blend_color(destination, color, n);
+}
+
+void (*alpha_blend_span)(uint16_t *, const uint16_t *, int) = alpha_blend_span_resolve;
+void (*alpha_blend_color)(uint16_t *, uint16_t, int) = alpha_blend_color_resolve;
+
+static void select_kernels()
+{
+	const char *name = "scalar";
+
+	alpha_blend_span = alpha_blend_span_scalar;
+	alpha_blend_color = alpha_blend_color_scalar;
+
+#ifdef BLEND_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		name = "avx2";
+		alpha_blend_span = alpha_blend_span_avx2;
+		alpha_blend_color = alpha_blend_color_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		name = "sse2";
+		alpha_blend_span = alpha_blend_span_sse2;
+		alpha_blend_color = alpha_blend_color_sse2;
+	}
+#endif
+
+	printf("[video] alpha blending with %s kernels\n", name);
+}
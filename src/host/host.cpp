@@ -9,7 +9,8 @@ E64::host_t::host_t()
 	       E64_YEAR, E64_MAJOR_VERSION, E64_MINOR_VERSION,
 	       E64_BUILD);
 	
-	video = new video_t();
+	video = nullptr;
+	headless = false;
 }
 
 E64::host_t::~host_t()
@@ -18,3 +19,9 @@ E64::host_t::~host_t()
 	
 	delete video;
 }
+
+void E64::host_t::init_video(bool headless_mode)
+{
+	headless = headless_mode;
+	video = new video_t(headless);
+}
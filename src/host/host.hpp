@@ -1,6 +1,7 @@
 #ifndef HOST_HPP
 #define HOST_HPP
 
+#include "pacer.hpp"
 #include "settings.hpp"
 #include "video.hpp"
 
@@ -14,7 +15,15 @@ public:
 	~host_t();
 	
 	settings_t settings;
+	pacer_t pacer;
 	video_t *video;
+	
+	/*
+	 * Headless mode runs without window and audio device. Must be
+	 * decided before init_video() is called.
+	 */
+	bool headless;
+	void init_video(bool headless_mode);
 };
 
 }
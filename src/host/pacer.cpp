@@ -0,0 +1,60 @@
+//  pacer.cpp
+//  E64
+//
+//  Copyright © 2021 elmerucr. All rights reserved.
+
+#include <thread>
+#include "pacer.hpp"
+
+E64::pacer_t::pacer_t()
+{
+	spin_threshold = 1000 * 1000;
+	reset();
+}
+
+void E64::pacer_t::reset()
+{
+	refresh_moment = std::chrono::steady_clock::now();
+}
+
+void E64::pacer_t::wait(uint32_t frametime)
+{
+	refresh_moment += std::chrono::microseconds(frametime);
+	
+	/*
+	 * Check if the next update is in the past, this can be the result
+	 * of a debug session. If so, calculate a new update moment. This
+	 * will avoid "playing catch-up" by the virtual machine.
+	 */
+	std::chrono::time_point<std::chrono::steady_clock> now =
+		std::chrono::steady_clock::now();
+	if (refresh_moment < now)
+		refresh_moment = now + std::chrono::microseconds(frametime);
+	
+	std::chrono::time_point<std::chrono::steady_clock> wake_up =
+		refresh_moment - std::chrono::nanoseconds(spin_threshold);
+	
+	if (wake_up > now) {
+		std::this_thread::sleep_until(wake_up);
+		
+		/*
+		 * Overshoot beyond the threshold raises it right away, so the
+		 * next frames are on time. Otherwise it slowly comes down
+		 * towards twice the overshoot, to give back the spinning.
+		 */
+		int64_t overshoot = std::chrono::duration_cast<std::chrono::nanoseconds>
+			(std::chrono::steady_clock::now() - wake_up).count();
+		if (overshoot > spin_threshold) {
+			spin_threshold = overshoot;
+		} else {
+			spin_threshold -= (spin_threshold - 2 * overshoot) / 64;
+		}
+		if (spin_threshold < PACER_MIN_SPIN_THRESHOLD * 1000)
+			spin_threshold = PACER_MIN_SPIN_THRESHOLD * 1000;
+		if (spin_threshold > PACER_MAX_SPIN_THRESHOLD * 1000)
+			spin_threshold = PACER_MAX_SPIN_THRESHOLD * 1000;
+	}
+	
+	while (std::chrono::steady_clock::now() < refresh_moment)
+		std::this_thread::yield();
+}
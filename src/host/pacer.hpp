@@ -0,0 +1,43 @@
+//  pacer.hpp
+//  E64
+//
+//  Copyright © 2021 elmerucr. All rights reserved.
+
+/*
+ * Frame pacing without vsync. A plain sleep until the next frame tends to
+ * wake up late on a loaded system. The pacer sleeps until a bit before the
+ * moment, and spins for the last stretch. How long that stretch is (the
+ * spin threshold) follows the overshoot of the sleeps it measures.
+ */
+
+#include <cstdint>
+#include <chrono>
+
+#ifndef PACER_HPP
+#define PACER_HPP
+
+#define PACER_MIN_SPIN_THRESHOLD	100	// microseconds
+#define PACER_MAX_SPIN_THRESHOLD	4000	// microseconds
+
+namespace E64
+{
+
+class pacer_t
+{
+private:
+	std::chrono::time_point<std::chrono::steady_clock> refresh_moment;
+	int64_t spin_threshold;		// in nanoseconds
+public:
+	pacer_t();
+	
+	void reset();
+	
+	// waits until the next frame is due, frametime in microseconds
+	void wait(uint32_t frametime);
+	
+	inline double current_spin_threshold() { return spin_threshold / 1000.0; }
+};
+
+}
+
+#endif
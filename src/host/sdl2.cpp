@@ -6,6 +6,7 @@
 #include <cstdio>
 #include <thread>
 #include <chrono>
+#include <atomic>
 #include <SDL2/SDL.h>
 #include "common.hpp"
 #include "sdl2.hpp"
@@ -16,12 +17,152 @@ bool audio_running;
 
 const uint8_t *E64_sdl2_keyboard_state;
 
+enum input_type {
+	INPUT_KEY_DOWN,
+	INPUT_KEY_UP,
+	INPUT_ALT_DOWN,
+	INPUT_ALT_UP,
+	INPUT_RESET,
+	INPUT_FLIP_MODES,
+	INPUT_TOGGLE_STATS
+};
 
-uint8_t *E64::sdl2_keys_last_known_state;
+struct input_event_t {
+	uint8_t type;
+	uint8_t scancode;
+};
+
+/*
+ * Input goes from the main thread (events) to the emulation thread
+ * through this queue. One producer and one consumer, each only writes its
+ * own index, so no locks are needed.
+ */
+class input_queue_t {
+private:
+	input_event_t events[256];
+	std::atomic<uint8_t> head;
+	std::atomic<uint8_t> tail;
+public:
+	input_queue_t() : head(0), tail(0) {}
+	
+	bool push(input_event_t event)
+	{
+		uint8_t h = head.load(std::memory_order_relaxed);
+		if ((uint8_t)(h + 1) == tail.load(std::memory_order_acquire)) return false;
+		events[h] = event;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+	
+	bool front(input_event_t *event)
+	{
+		uint8_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return false;
+		*event = events[t];
+		return true;
+	}
+	
+	void pop()
+	{
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+};
+
+static input_queue_t input_queue;
+
+// main thread side, last sent key states
+static uint8_t keys_sent[128];
+static bool alt_sent;
+
+// emulation thread side
+static uint8_t keys_pressed[128];
+static bool alt_held;
+static uint8_t pending_commands[256];
+static int no_of_pending_commands;
+
+static const struct {
+	uint8_t scancode;
+	SDL_Scancode sdl_scancode;
+} key_map[] = {
+	{ E64::SCANCODE_ESCAPE, SDL_SCANCODE_ESCAPE },
+	{ E64::SCANCODE_F1, SDL_SCANCODE_F1 },
+	{ E64::SCANCODE_F2, SDL_SCANCODE_F2 },
+	{ E64::SCANCODE_F3, SDL_SCANCODE_F3 },
+	{ E64::SCANCODE_F4, SDL_SCANCODE_F4 },
+	{ E64::SCANCODE_F5, SDL_SCANCODE_F5 },
+	{ E64::SCANCODE_F6, SDL_SCANCODE_F6 },
+	{ E64::SCANCODE_F7, SDL_SCANCODE_F7 },
+	{ E64::SCANCODE_F8, SDL_SCANCODE_F8 },
+	{ E64::SCANCODE_GRAVE, SDL_SCANCODE_GRAVE },
+	{ E64::SCANCODE_1, SDL_SCANCODE_1 },
+	{ E64::SCANCODE_2, SDL_SCANCODE_2 },
+	{ E64::SCANCODE_3, SDL_SCANCODE_3 },
+	{ E64::SCANCODE_4, SDL_SCANCODE_4 },
+	{ E64::SCANCODE_5, SDL_SCANCODE_5 },
+	{ E64::SCANCODE_6, SDL_SCANCODE_6 },
+	{ E64::SCANCODE_7, SDL_SCANCODE_7 },
+	{ E64::SCANCODE_8, SDL_SCANCODE_8 },
+	{ E64::SCANCODE_9, SDL_SCANCODE_9 },
+	{ E64::SCANCODE_0, SDL_SCANCODE_0 },
+	{ E64::SCANCODE_MINUS, SDL_SCANCODE_MINUS },
+	{ E64::SCANCODE_EQUALS, SDL_SCANCODE_EQUALS },
+	{ E64::SCANCODE_BACKSPACE, SDL_SCANCODE_BACKSPACE },
+	{ E64::SCANCODE_TAB, SDL_SCANCODE_TAB },
+	{ E64::SCANCODE_Q, SDL_SCANCODE_Q },
+	{ E64::SCANCODE_W, SDL_SCANCODE_W },
+	{ E64::SCANCODE_E, SDL_SCANCODE_E },
+	{ E64::SCANCODE_R, SDL_SCANCODE_R },
+	{ E64::SCANCODE_T, SDL_SCANCODE_T },
+	{ E64::SCANCODE_Y, SDL_SCANCODE_Y },
+	{ E64::SCANCODE_U, SDL_SCANCODE_U },
+	{ E64::SCANCODE_I, SDL_SCANCODE_I },
+	{ E64::SCANCODE_O, SDL_SCANCODE_O },
+	{ E64::SCANCODE_P, SDL_SCANCODE_P },
+	{ E64::SCANCODE_LEFTBRACKET, SDL_SCANCODE_LEFTBRACKET },
+	{ E64::SCANCODE_RIGHTBRACKET, SDL_SCANCODE_RIGHTBRACKET },
+	{ E64::SCANCODE_RETURN, SDL_SCANCODE_RETURN },
+	{ E64::SCANCODE_A, SDL_SCANCODE_A },
+	{ E64::SCANCODE_S, SDL_SCANCODE_S },
+	{ E64::SCANCODE_D, SDL_SCANCODE_D },
+	{ E64::SCANCODE_F, SDL_SCANCODE_F },
+	{ E64::SCANCODE_G, SDL_SCANCODE_G },
+	{ E64::SCANCODE_H, SDL_SCANCODE_H },
+	{ E64::SCANCODE_J, SDL_SCANCODE_J },
+	{ E64::SCANCODE_K, SDL_SCANCODE_K },
+	{ E64::SCANCODE_L, SDL_SCANCODE_L },
+	{ E64::SCANCODE_SEMICOLON, SDL_SCANCODE_SEMICOLON },
+	{ E64::SCANCODE_APOSTROPHE, SDL_SCANCODE_APOSTROPHE },
+	{ E64::SCANCODE_BACKSLASH, SDL_SCANCODE_BACKSLASH },
+	{ E64::SCANCODE_LSHIFT, SDL_SCANCODE_LSHIFT },
+	{ E64::SCANCODE_Z, SDL_SCANCODE_Z },
+	{ E64::SCANCODE_X, SDL_SCANCODE_X },
+	{ E64::SCANCODE_C, SDL_SCANCODE_C },
+	{ E64::SCANCODE_V, SDL_SCANCODE_V },
+	{ E64::SCANCODE_B, SDL_SCANCODE_B },
+	{ E64::SCANCODE_N, SDL_SCANCODE_N },
+	{ E64::SCANCODE_M, SDL_SCANCODE_M },
+	{ E64::SCANCODE_COMMA, SDL_SCANCODE_COMMA },
+	{ E64::SCANCODE_PERIOD, SDL_SCANCODE_PERIOD },
+	{ E64::SCANCODE_SLASH, SDL_SCANCODE_SLASH },
+	{ E64::SCANCODE_RSHIFT, SDL_SCANCODE_RSHIFT },
+	{ E64::SCANCODE_LCTRL, SDL_SCANCODE_LCTRL },
+	{ E64::SCANCODE_SPACE, SDL_SCANCODE_SPACE },
+	{ E64::SCANCODE_RCTRL, SDL_SCANCODE_RCTRL },
+	{ E64::SCANCODE_LEFT, SDL_SCANCODE_LEFT },
+	{ E64::SCANCODE_UP, SDL_SCANCODE_UP },
+	{ E64::SCANCODE_DOWN, SDL_SCANCODE_DOWN },
+	{ E64::SCANCODE_RIGHT, SDL_SCANCODE_RIGHT },
+};
+
+
+/*
+ * Statically allocated, so the cia can also run when sdl2_init() hasn't been
+ * called (headless).
+ */
+uint8_t E64::sdl2_keys_last_known_state[128];
 
 void E64::sdl2_init()
 {
-	sdl2_keys_last_known_state = new uint8_t[128];
 	for (int i=0; i<128; i++) sdl2_keys_last_known_state[i] = 0;
 	
     SDL_Init(SDL_INIT_AUDIO);
@@ -98,9 +239,7 @@ int E64::sdl2_process_events()
                 }
                 else if( (event.key.keysym.sym == SDLK_r) && alt_pressed ) {
 			E64::sdl2_wait_until_r_released();
-			machine.reset();
-			//hud.reset();
-			stats.reset();
+			input_queue.push({ INPUT_RESET, 0 });
                 }
                 else if( (event.key.keysym.sym == SDLK_q) && alt_pressed )
                 {
@@ -108,13 +247,12 @@ int E64::sdl2_process_events()
                     return_value = QUIT_EVENT;
                 }
 		else if(event.key.keysym.sym == SDLK_F9) {
-			hud.flip_modes();
-			      //hud.overhead_visible = !hud.overhead_visible;
+			input_queue.push({ INPUT_FLIP_MODES, 0 });
 			sdl2_wait_until_f9_released();
 		      }
                 else if(event.key.keysym.sym == SDLK_F10)
                     {
-			    hud.stats_visible = !hud.stats_visible;
+			    input_queue.push({ INPUT_TOGGLE_STATS, 0 });
                     }
                 break;
             case SDL_WINDOWEVENT:
@@ -129,92 +267,106 @@ int E64::sdl2_process_events()
         }
     }
 
-    // update keystates in cia chip
-    if( !alt_pressed )
-    {
-	    sdl2_keys_last_known_state[SCANCODE_ESCAPE] = E64_sdl2_keyboard_state[SDL_SCANCODE_ESCAPE] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F1] = E64_sdl2_keyboard_state[SDL_SCANCODE_F1] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F2] = E64_sdl2_keyboard_state[SDL_SCANCODE_F2] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F3] = E64_sdl2_keyboard_state[SDL_SCANCODE_F3] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F4] = E64_sdl2_keyboard_state[SDL_SCANCODE_F4] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F5] = E64_sdl2_keyboard_state[SDL_SCANCODE_F5] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F6] = E64_sdl2_keyboard_state[SDL_SCANCODE_F6] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F7] = E64_sdl2_keyboard_state[SDL_SCANCODE_F7] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F8] = E64_sdl2_keyboard_state[SDL_SCANCODE_F8] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_GRAVE] = (machine.cia->registers[SCANCODE_GRAVE] << 1) | (E64_sdl2_keyboard_state[SDL_SCANCODE_GRAVE] ? 0x01 : 0x00);
-	    sdl2_keys_last_known_state[SCANCODE_1] = E64_sdl2_keyboard_state[SDL_SCANCODE_1] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_2] = E64_sdl2_keyboard_state[SDL_SCANCODE_2] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_3] = E64_sdl2_keyboard_state[SDL_SCANCODE_3] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_4] = E64_sdl2_keyboard_state[SDL_SCANCODE_4] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_5] = E64_sdl2_keyboard_state[SDL_SCANCODE_5] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_6] = E64_sdl2_keyboard_state[SDL_SCANCODE_6] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_7] = E64_sdl2_keyboard_state[SDL_SCANCODE_7] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_8] = E64_sdl2_keyboard_state[SDL_SCANCODE_8] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_9] = E64_sdl2_keyboard_state[SDL_SCANCODE_9] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_0] = E64_sdl2_keyboard_state[SDL_SCANCODE_0] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_MINUS] = E64_sdl2_keyboard_state[SDL_SCANCODE_MINUS] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_EQUALS] = E64_sdl2_keyboard_state[SDL_SCANCODE_EQUALS] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_BACKSPACE] = E64_sdl2_keyboard_state[SDL_SCANCODE_BACKSPACE] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_TAB] = E64_sdl2_keyboard_state[SDL_SCANCODE_TAB] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_Q] = E64_sdl2_keyboard_state[SDL_SCANCODE_Q] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_W] = E64_sdl2_keyboard_state[SDL_SCANCODE_W] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_E] = E64_sdl2_keyboard_state[SDL_SCANCODE_E] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_R] = E64_sdl2_keyboard_state[SDL_SCANCODE_R] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_T] = E64_sdl2_keyboard_state[SDL_SCANCODE_T] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_Y] = E64_sdl2_keyboard_state[SDL_SCANCODE_Y] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_U] = E64_sdl2_keyboard_state[SDL_SCANCODE_U] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_I] = E64_sdl2_keyboard_state[SDL_SCANCODE_I] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_O] = E64_sdl2_keyboard_state[SDL_SCANCODE_O] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_P] = E64_sdl2_keyboard_state[SDL_SCANCODE_P] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_LEFTBRACKET] = E64_sdl2_keyboard_state[SDL_SCANCODE_LEFTBRACKET] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_RIGHTBRACKET] = E64_sdl2_keyboard_state[SDL_SCANCODE_RIGHTBRACKET] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_RETURN] = E64_sdl2_keyboard_state[SDL_SCANCODE_RETURN] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_A] = E64_sdl2_keyboard_state[SDL_SCANCODE_A] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_S] = E64_sdl2_keyboard_state[SDL_SCANCODE_S] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_D] = E64_sdl2_keyboard_state[SDL_SCANCODE_D] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_F] = E64_sdl2_keyboard_state[SDL_SCANCODE_F] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_G] = E64_sdl2_keyboard_state[SDL_SCANCODE_G] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_H] = E64_sdl2_keyboard_state[SDL_SCANCODE_H] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_J] = E64_sdl2_keyboard_state[SDL_SCANCODE_J] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_K] = E64_sdl2_keyboard_state[SDL_SCANCODE_K] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_L] = E64_sdl2_keyboard_state[SDL_SCANCODE_L] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_SEMICOLON] = E64_sdl2_keyboard_state[SDL_SCANCODE_SEMICOLON] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_APOSTROPHE] = E64_sdl2_keyboard_state[SDL_SCANCODE_APOSTROPHE] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_BACKSLASH] = E64_sdl2_keyboard_state[SDL_SCANCODE_BACKSLASH] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_LSHIFT] = E64_sdl2_keyboard_state[SDL_SCANCODE_LSHIFT] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_Z] = E64_sdl2_keyboard_state[SDL_SCANCODE_Z] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_X] = E64_sdl2_keyboard_state[SDL_SCANCODE_X] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_C] = E64_sdl2_keyboard_state[SDL_SCANCODE_C] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_V] = E64_sdl2_keyboard_state[SDL_SCANCODE_V] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_B] = E64_sdl2_keyboard_state[SDL_SCANCODE_B] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_N] = E64_sdl2_keyboard_state[SDL_SCANCODE_N] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_M] = E64_sdl2_keyboard_state[SDL_SCANCODE_M] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_COMMA] = E64_sdl2_keyboard_state[SDL_SCANCODE_COMMA] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_PERIOD] = E64_sdl2_keyboard_state[SDL_SCANCODE_PERIOD] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_SLASH] = E64_sdl2_keyboard_state[SDL_SCANCODE_SLASH] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_RSHIFT] = E64_sdl2_keyboard_state[SDL_SCANCODE_RSHIFT] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_LCTRL] = E64_sdl2_keyboard_state[SDL_SCANCODE_LCTRL] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_SPACE] = E64_sdl2_keyboard_state[SDL_SCANCODE_SPACE] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_RCTRL] = E64_sdl2_keyboard_state[SDL_SCANCODE_RCTRL] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_LEFT] = E64_sdl2_keyboard_state[SDL_SCANCODE_LEFT] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_UP] = E64_sdl2_keyboard_state[SDL_SCANCODE_UP] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_DOWN] = E64_sdl2_keyboard_state[SDL_SCANCODE_DOWN] ? 0x01 : 0x00;
-	    sdl2_keys_last_known_state[SCANCODE_RIGHT] = E64_sdl2_keyboard_state[SDL_SCANCODE_RIGHT] ? 0x01 : 0x00;
+	/*
+	 * Queue key changes. A change that doesn't fit in the queue is
+	 * simply tried again next time.
+	 */
+	if (alt_pressed != alt_sent) {
+		if (input_queue.push({ alt_pressed ? INPUT_ALT_DOWN : INPUT_ALT_UP, 0 }))
+			alt_sent = alt_pressed;
+	}
+	for (unsigned i=0; i<sizeof(key_map)/sizeof(key_map[0]); i++) {
+		uint8_t pressed = E64_sdl2_keyboard_state[key_map[i].sdl_scancode] ? 0x01 : 0x00;
+		if (pressed != keys_sent[key_map[i].scancode]) {
+			if (input_queue.push({ pressed ? INPUT_KEY_DOWN : INPUT_KEY_UP, key_map[i].scancode }))
+				keys_sent[key_map[i].scancode] = pressed;
+		}
 	}
+	
 	if (return_value == QUIT_EVENT)
 		printf("[SDL] detected quit event\n");
 	return return_value;
 }
 
+static void run_command(uint8_t type)
+{
+	switch (type) {
+		case INPUT_RESET:
+			machine.reset();
+			//hud.reset();
+			stats.reset();
+			break;
+		case INPUT_FLIP_MODES:
+			hud.flip_modes();
+			//hud.overhead_visible = !hud.overhead_visible;
+			break;
+		case INPUT_TOGGLE_STATS:
+			hud.stats_visible = !hud.stats_visible;
+			break;
+	}
+}
+
+/*
+ * Takes in queued input. With keys_only, commands are put aside until
+ * the next sdl2_process_input(), so they are never run from inside
+ * another one, and key events behind them still come through.
+ */
+static void take_input(bool keys_only)
+{
+	input_event_t event;
+	
+	while (input_queue.front(&event)) {
+		input_queue.pop();
+		switch (event.type) {
+			case INPUT_KEY_DOWN:
+				keys_pressed[event.scancode] = 0x01;
+				break;
+			case INPUT_KEY_UP:
+				keys_pressed[event.scancode] = 0x00;
+				break;
+			case INPUT_ALT_DOWN:
+				alt_held = true;
+				break;
+			case INPUT_ALT_UP:
+				alt_held = false;
+				break;
+			default:
+				if (!keys_only) {
+					run_command(event.type);
+				} else if (no_of_pending_commands < 256) {
+					pending_commands[no_of_pending_commands++] = event.type;
+				}
+				break;
+		}
+	}
+}
+
+void E64::sdl2_process_input()
+{
+	// commands put aside came in before anything still queued
+	for (int i=0; i<no_of_pending_commands; i++)
+		run_command(pending_commands[i]);
+	no_of_pending_commands = 0;
+	take_input(false);
+	
+	// update keystates in cia chip
+	if (!alt_held) {
+		for (unsigned i=0; i<sizeof(key_map)/sizeof(key_map[0]); i++)
+			sdl2_keys_last_known_state[key_map[i].scancode] = keys_pressed[key_map[i].scancode];
+		sdl2_keys_last_known_state[SCANCODE_GRAVE] |= machine.cia->registers[SCANCODE_GRAVE] << 1;
+	}
+}
+
+/*
+ * Called from the emulation thread (hud commands), so this waits for the
+ * key to come up through the input queue.
+ */
 void E64::sdl2_wait_until_enter_released()
 {
-	SDL_Event event;
-	bool wait = true;
-	while (wait) {
-		SDL_PollEvent(&event);
-		if ((event.type == SDL_KEYUP) && (event.key.keysym.sym == SDLK_RETURN))
-			wait = false;
+	take_input(true);
+	while (keys_pressed[SCANCODE_RETURN] && app_running) {
 		std::this_thread::sleep_for(std::chrono::microseconds(40000));
+		take_input(true);
 	}
 }
 
@@ -265,19 +417,24 @@ void E64::sdl2_wait_until_r_released()
 }
 
 
+/*
+ * Without an opened audio device (headless or failed to open), generated
+ * samples are simply dropped.
+ */
 void E64::sdl2_queue_audio(void *buffer, unsigned size)
 {
-    SDL_QueueAudio(E64_sdl2_audio_dev, buffer, size);
+	if (E64_sdl2_audio_dev)
+		SDL_QueueAudio(E64_sdl2_audio_dev, buffer, size);
 }
 
 unsigned int E64::sdl2_get_queued_audio_size()
 {
-    return SDL_GetQueuedAudioSize(E64_sdl2_audio_dev);
+	return E64_sdl2_audio_dev ? SDL_GetQueuedAudioSize(E64_sdl2_audio_dev) : 0;
 }
 
 void E64::sdl2_start_audio()
 {
-	if (!audio_running) {
+	if (!audio_running && E64_sdl2_audio_dev) {
 		printf("[SDL] start audio\n");
 		// Unpause audiodevice, and process audiostream
 		SDL_PauseAudioDevice(E64_sdl2_audio_dev, 0);
@@ -301,5 +458,4 @@ void E64::sdl2_cleanup()
     E64::sdl2_stop_audio();
     SDL_CloseAudioDevice(E64_sdl2_audio_dev);
     //SDL_Quit();
-	delete sdl2_keys_last_known_state;
 }
@@ -19,11 +19,17 @@ namespace E64
     void sdl2_init();
     void sdl2_cleanup();
 
-	// key states
-	extern uint8_t *sdl2_keys_last_known_state;
+	// key states, as seen by the cia
+	extern uint8_t sdl2_keys_last_known_state[128];
 
-    // event related
+	/*
+	 * Host input. sdl2_process_events() runs on the main thread and
+	 * queues key changes and commands for the machine.
+	 * sdl2_process_input() runs on the emulation thread once per frame,
+	 * takes them in and updates the key states.
+	 */
     int sdl2_process_events();
+	void sdl2_process_input();
     void sdl2_wait_until_enter_released();
     void sdl2_wait_until_f_released();
     void sdl2_wait_until_q_released();
@@ -24,7 +24,7 @@ void E64::stats_t::reset()
 	status_bar_framecounter = 0;
 	status_bar_framecounter_interval = FPS / 2;
 
-	smoothed_audio_queue_size = AUDIO_BUFFER_SIZE;
+	audio_queue_size = smoothed_audio_queue_size = AUDIO_BUFFER_SIZE;
 	
 	smoothed_framerate = FPS;
 	
@@ -39,6 +39,10 @@ void E64::stats_t::reset()
 	alpha_cpu = 0.50f;
 	
 	frametime = 1000000 / FPS;
+	
+	for (int i=0; i<STATS_INTERVAL_BUCKETS; i++) interval_histogram[i] = 0;
+	no_of_intervals = 0;
+	max_interval = 0;
 
 	now = then = std::chrono::steady_clock::now();
 }
@@ -88,6 +92,42 @@ void E64::stats_t::end_idle_time()
 {
 	now = std::chrono::steady_clock::now();
 	total_idle_time += std::chrono::duration_cast<std::chrono::microseconds>(now - done).count();
-	total_time += std::chrono::duration_cast<std::chrono::microseconds>(now - then).count();
+	int64_t interval = std::chrono::duration_cast<std::chrono::microseconds>(now - then).count();
+	total_time += interval;
 	then = now;
+	
+	int64_t bucket = interval / STATS_INTERVAL_BUCKET_SIZE;
+	if (bucket >= STATS_INTERVAL_BUCKETS) bucket = STATS_INTERVAL_BUCKETS - 1;
+	interval_histogram[bucket]++;
+	no_of_intervals++;
+	if (interval > max_interval) max_interval = interval;
+}
+
+/*
+ * Upper bound of the bucket the percentile falls in, so results are
+ * rounded up to STATS_INTERVAL_BUCKET_SIZE.
+ */
+double E64::stats_t::frame_interval_percentile(double percentile)
+{
+	if (no_of_intervals == 0) return 0.0;
+	
+	uint32_t rank = (uint32_t)((percentile / 100.0) * no_of_intervals);
+	if (rank >= no_of_intervals) rank = no_of_intervals - 1;
+	
+	uint32_t count = 0;
+	for (int i=0; i<STATS_INTERVAL_BUCKETS; i++) {
+		count += interval_histogram[i];
+		if (count > rank)
+			return ((i + 1) * STATS_INTERVAL_BUCKET_SIZE) / 1000.0;
+	}
+	return max_frame_interval();
+}
+
+char *E64::stats_t::pacing_summary()
+{
+	snprintf(pacing_string, 256, "\nframe interval p50: %5.2f ms  p99: %5.2f ms  max: %5.2f ms\n%u frames, spin threshold %.2f ms",
+		 frame_interval_percentile(50), frame_interval_percentile(99),
+		 max_frame_interval(), no_of_intervals,
+		 host.pacer.current_spin_threshold() / 1000);
+	return pacing_string;
 }
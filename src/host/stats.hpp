@@ -9,6 +9,9 @@
 #ifndef STATS_HPP
 #define STATS_HPP
 
+#define STATS_INTERVAL_BUCKET_SIZE	50	// microseconds
+#define STATS_INTERVAL_BUCKETS		1000	// last one also takes longer intervals
+
 namespace E64
 {
 
@@ -47,6 +50,16 @@ private:
     double smoothed_idle_per_frame;
     
     char statistics_string[256];
+	
+	/*
+	 * Histogram of frame intervals (time between the ends of two
+	 * frames) since the last reset.
+	 */
+	uint32_t interval_histogram[STATS_INTERVAL_BUCKETS];
+	uint32_t no_of_intervals;
+	int64_t max_interval;
+	
+	char pacing_string[256];
     
 public:
     void reset();
@@ -65,6 +78,11 @@ public:
     inline double current_audio_queue_size() { return audio_queue_size; }
     inline double current_smoothed_audio_queue_size() { return smoothed_audio_queue_size; }
     inline char *summary() { return statistics_string; }
+	
+	// frame intervals in ms
+	double frame_interval_percentile(double percentile);
+	inline double max_frame_interval() { return max_interval / 1000.0; }
+	char *pacing_summary();
 };
 
 }
@@ -7,9 +7,37 @@
 #include "common.hpp"
 #include <cstring>
 
-E64::video_t::video_t()
+E64::video_t::video_t(bool headless_mode)
 {
 	framebuffer = new uint16_t[VICV_PIXELS_PER_SCANLINE * VICV_SCANLINES];
+	scanline = new uint16_t[VICV_PIXELS_PER_SCANLINE];
+	
+	// the texture starts out unknown, so the first frame goes up whole
+	memset(framebuffer, 0, VICV_TOTAL_PIXELS * sizeof(*framebuffer));
+	dirty_rects[0] = { 0, 0, VICV_PIXELS_PER_SCANLINE, VICV_SCANLINES };
+	no_of_dirty_rects = 1;
+	
+	for (int i=0; i<3; i++) {
+		for (int j=0; j<COMPOSITOR_MAX_LAYERS; j++) frames[i].buffers[j] = nullptr;
+		frames[i].no_of_layers = 0;
+	}
+	frame_write = 0;
+	frame_ready = 1;
+	frame_read = 2;
+	frame_fresh = false;
+	presenting = false;
+	
+	headless = headless_mode;
+	if (headless) {
+		printf("[SDL Display] headless, no window will be created\n");
+		window = nullptr;
+		renderer = nullptr;
+		texture = nullptr;
+		vsync = false;
+		current_window_size = 3;
+		fullscreen = false;
+		return;
+	}
 	
 	SDL_version compiled;
 	SDL_version linked;
@@ -61,7 +89,7 @@ E64::video_t::video_t()
 	
 	update_title();
     
-	/* Create renderer and link it to window */
+	/* Create renderer and link it to window, see create_renderer() */
 
 	SDL_DisplayMode current_mode;
 
@@ -75,11 +103,163 @@ E64::video_t::video_t()
     
 	if (current_mode.refresh_rate == FPS) {
 		printf("[SDL Display] this is equal to the FPS of E64-II, trying for vsync\n");
+		vsync = true;
+	} else {
+		printf("[SDL Display] this differs from the FPS of E64-II, going for software FPS\n");
+		vsync = false;
+	}
+	
+	create_renderer();
+	presenting = true;
+
+	// make sure mouse cursor isn't visible
+	SDL_ShowCursor(SDL_DISABLE);
+}
+
+E64::video_t::~video_t()
+{
+	if (!headless) {
+		printf("[SDL] cleaning up video\n");
+		SDL_DestroyTexture(texture);
+		SDL_DestroyRenderer(renderer);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+	}
+	
+	for (int i=0; i<3; i++) {
+		for (int j=0; j<COMPOSITOR_MAX_LAYERS; j++)
+			delete [] frames[i].buffers[j];
+	}
+	delete [] scanline;
+	delete [] framebuffer;
+}
+
+/*
+ * Blends the layers, bottom one first, onto a cleared scanline. This is
+ * done one scanline at a time, so each line is cleared and blended while
+ * it is still in the cache, instead of going over the whole framebuffer
+ * once per layer. Only scanlines that turn out different from the
+ * framebuffer are copied in and marked dirty.
+ */
+void E64::video_t::composite(const layer_t *layers, int no_of_layers)
+{
+	const uint16_t *visible_layers[COMPOSITOR_MAX_LAYERS];
+	int no_of_visible_layers = 0;
+	
+	for (int i=0; i<no_of_layers; i++) {
+		if (!layers[i].transparent && (no_of_visible_layers < COMPOSITOR_MAX_LAYERS))
+			visible_layers[no_of_visible_layers++] = layers[i].pixels;
+	}
+	
+	for (int y=0; y<VICV_SCANLINES; y++) {
+		int offset = y * VICV_PIXELS_PER_SCANLINE;
+		memset(scanline, 0, VICV_PIXELS_PER_SCANLINE * sizeof(*scanline));
+		for (int i=0; i<no_of_visible_layers; i++)
+			alpha_blend_span(scanline, &visible_layers[i][offset],
+					 VICV_PIXELS_PER_SCANLINE);
+		if (memcmp(&framebuffer[offset], scanline, VICV_PIXELS_PER_SCANLINE * sizeof(*scanline))) {
+			memcpy(&framebuffer[offset], scanline, VICV_PIXELS_PER_SCANLINE * sizeof(*scanline));
+			mark_dirty(y);
+		}
+	}
+}
+
+/*
+ * Scanlines are marked top to bottom. Adjacent ones extend the last run,
+ * and once all rects are in use, the last one is stretched to cover the
+ * rest.
+ */
+void E64::video_t::mark_dirty(int scanline_no)
+{
+	if (no_of_dirty_rects) {
+		SDL_Rect *last = &dirty_rects[no_of_dirty_rects - 1];
+		if ((last->y + last->h == scanline_no) ||
+		    (no_of_dirty_rects == VIDEO_MAX_DIRTY_RECTS)) {
+			last->h = scanline_no + 1 - last->y;
+			return;
+		}
+	}
+	dirty_rects[no_of_dirty_rects++] = { 0, scanline_no, VICV_PIXELS_PER_SCANLINE, 1 };
+}
+
+/*
+ * Copies the layers into the frame being written and hands it to the main
+ * thread. With vsync, this waits until the previous frame has been taken,
+ * which paces the emulation to the display. Without vsync, a frame the
+ * main thread didn't get to is just replaced.
+ */
+void E64::video_t::submit_frame(const layer_t *layers, int no_of_layers)
+{
+	frame_t *frame = &frames[frame_write];
+	
+	if (no_of_layers > COMPOSITOR_MAX_LAYERS) no_of_layers = COMPOSITOR_MAX_LAYERS;
+	for (int i=0; i<no_of_layers; i++) {
+		frame->layers[i].transparent = layers[i].transparent;
+		frame->layers[i].pixels = frame->buffers[i];
+		if (layers[i].transparent) continue;
+		if (frame->buffers[i] == nullptr) {
+			frame->buffers[i] = new uint16_t[VICV_TOTAL_PIXELS];
+			frame->layers[i].pixels = frame->buffers[i];
+		}
+		memcpy(frame->buffers[i], layers[i].pixels, VICV_TOTAL_PIXELS * sizeof(uint16_t));
+	}
+	frame->no_of_layers = no_of_layers;
+	
+	{
+		std::unique_lock<std::mutex> lock(frame_mutex);
+		if (vsync) frame_taken.wait(lock, [this] { return !frame_fresh || !presenting; });
+		int temp = frame_ready;
+		frame_ready = frame_write;
+		frame_write = temp;
+		frame_fresh = true;
+	}
+	frame_available.notify_one();
+}
+
+/*
+ * Called from the main thread, in between event handling, as SDL wants
+ * all rendering done there. Waits at most timeout ms for a frame to come
+ * in, then composites and presents it. Returns false if there was none.
+ */
+bool E64::video_t::present_frame(uint32_t timeout)
+{
+	{
+		std::unique_lock<std::mutex> lock(frame_mutex);
+		if (!frame_available.wait_for(lock, std::chrono::milliseconds(timeout),
+					      [this] { return frame_fresh; }))
+			return false;
+		int temp = frame_read;
+		frame_read = frame_ready;
+		frame_ready = temp;
+		frame_fresh = false;
+	}
+	frame_taken.notify_one();
+	
+	composite(frames[frame_read].layers, frames[frame_read].no_of_layers);
+	update_screen();
+	return true;
+}
+
+/*
+ * No more frames will be taken, so the emulation mustn't wait for that
+ * when it hands in its last one.
+ */
+void E64::video_t::stop_presenting()
+{
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		presenting = false;
+	}
+	frame_taken.notify_all();
+}
+
+void E64::video_t::create_renderer()
+{
+	if (vsync) {
 		renderer = SDL_CreateRenderer(window, -1,
 					      SDL_RENDERER_ACCELERATED |
 					      SDL_RENDERER_PRESENTVSYNC);
 	} else {
-		printf("[SDL Display] this differs from the FPS of E64-II, going for software FPS\n");
 		renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
 	}
 
@@ -100,41 +280,19 @@ E64::video_t::video_t()
 	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB4444,
 				    SDL_TEXTUREACCESS_STREAMING,
 				    VICV_PIXELS_PER_SCANLINE, VICV_SCANLINES);
-
-	// make sure mouse cursor isn't visible
-	SDL_ShowCursor(SDL_DISABLE);
-}
-
-E64::video_t::~video_t()
-{
-	printf("[SDL] cleaning up video\n");
-	SDL_DestroyTexture(texture);
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
-	SDL_Quit();
-	
-	delete [] framebuffer;
-}
-
-void E64::video_t::clear_frame_buffer()
-{
-	memset(framebuffer, 0, VICV_TOTAL_PIXELS * sizeof(*framebuffer));
-}
-
-void E64::video_t::merge_down_layer(uint16_t *buffer)
-{
-	uint16_t *temp_framebuffer = framebuffer;
-	for (int i=0; i < VICV_TOTAL_PIXELS; i++) {
-		alpha_blend(temp_framebuffer++, buffer++);
-	}
 }
 
 void E64::video_t::update_screen()
 {
 	SDL_RenderClear(renderer);
 
-	SDL_UpdateTexture(texture, NULL, framebuffer,
-		VICV_PIXELS_PER_SCANLINE * sizeof(uint16_t));
+	// nothing is uploaded if the frame didn't change
+	for (int i=0; i<no_of_dirty_rects; i++) {
+		SDL_UpdateTexture(texture, &dirty_rects[i],
+			&framebuffer[dirty_rects[i].y * VICV_PIXELS_PER_SCANLINE],
+			VICV_PIXELS_PER_SCANLINE * sizeof(uint16_t));
+	}
+	no_of_dirty_rects = 0;
     
 	SDL_RenderCopy(renderer, texture, NULL, NULL);
 
@@ -4,10 +4,15 @@
 //  Copyright © 2020 elmerucr. All rights reserved.
 
 #include <SDL2/SDL.h>
+#include <mutex>
+#include <condition_variable>
 
 #ifndef VIDEO_HPP
 #define VIDEO_HPP
 
+#define COMPOSITOR_MAX_LAYERS	8
+#define VIDEO_MAX_DIRTY_RECTS	16
+
 /*
  * The alpha_blend function takes the current color (destination, which is
  * also the destination) and the color that must be blended (source). It
@@ -73,8 +78,44 @@ inline void alpha_blend(uint16_t *destination, uint16_t *source)
 	*destination = (a_dest << 12) | (r_dest << 8) | (g_dest << 4) | b_dest;
 }
 
+/*
+ * Update 2021-05-02, blending of whole spans
+ *
+ * alpha_blend_span blends n source pixels onto n destination pixels,
+ * alpha_blend_color blends one color onto n destination pixels. They point
+ * to SIMD kernels (SSE2 or AVX2, 8 or 16 pixels at a time) picked at
+ * runtime for the cpu at hand, or to the scalar kernels below, which use
+ * alpha_blend() and remain the reference. Results are bit exact.
+ */
+extern void (*alpha_blend_span)(uint16_t *destination, const uint16_t *source, int n);
+extern void (*alpha_blend_color)(uint16_t *destination, uint16_t color, int n);
+
+void alpha_blend_span_scalar(uint16_t *destination, const uint16_t *source, int n);
+void alpha_blend_color_scalar(uint16_t *destination, uint16_t color, int n);
+
 namespace E64 {
 
+/*
+ * A layer for the compositor. Layers known to be fully transparent are
+ * skipped.
+ */
+struct layer_t
+{
+	const uint16_t *pixels;
+	bool transparent;
+};
+
+/*
+ * Copies of the layers of one finished frame, as handed to the render
+ * thread.
+ */
+struct frame_t
+{
+	uint16_t *buffers[COMPOSITOR_MAX_LAYERS];
+	layer_t layers[COMPOSITOR_MAX_LAYERS];
+	int no_of_layers;
+};
+
 struct window_size
 {
     uint16_t x;
@@ -100,13 +141,46 @@ private:
 	int window_height;
 	
 	uint16_t *framebuffer;
+	
+	/*
+	 * Scanlines that differ from what the texture holds, as runs of
+	 * whole scanlines. Only these get uploaded.
+	 */
+	uint16_t *scanline;
+	SDL_Rect dirty_rects[VIDEO_MAX_DIRTY_RECTS];
+	int no_of_dirty_rects;
+	void mark_dirty(int scanline_no);
+	
+	// no window, renderer and texture when headless
+	bool headless;
+	
+	/*
+	 * Triple buffering. The emulation fills frames[frame_write], the
+	 * main thread presents frames[frame_read], and they trade through
+	 * frames[frame_ready]. frame_fresh tells if the ready frame hasn't
+	 * been taken yet. Once presenting stops, submitted frames are no
+	 * longer waited for.
+	 */
+	frame_t frames[3];
+	int frame_write;
+	int frame_ready;
+	int frame_read;
+	bool frame_fresh;
+	bool presenting;
+	std::mutex frame_mutex;
+	std::condition_variable frame_available;
+	std::condition_variable frame_taken;
+	
+	void create_renderer();
+	void update_screen();
 public:
-	video_t();
+	video_t(bool headless_mode);
 	~video_t();
 
-	void clear_frame_buffer();
-	void merge_down_layer(uint16_t *buffer);
-	void update_screen();
+	void composite(const layer_t *layers, int no_of_layers);
+	void submit_frame(const layer_t *layers, int no_of_layers);
+	bool present_frame(uint32_t timeout);
+	void stop_presenting();
 	void update_title();
 	void reset_window_size();
 	void increase_window_size();
@@ -41,48 +41,49 @@ E64::hud_t::hud_t()
 	luaopen_math(L);
 	luaopen_string(L);
 	
+	scheduler = new scheduler_t();
 	exceptions = new exceptions_ic();
 	blitter = new blitter_ic();
-	cia = new cia_ic();
-	timer = new timer_ic(exceptions);
+	cia = new cia_ic(scheduler);
+	timer = new timer_ic(exceptions, scheduler);
 	
-	stats_view = &blitter->blit[0];
+	stats_view = blitter->get_blit(0);
 	stats_view->terminal_init(0b10001010, 0b00000000, 0x25, GREEN_05,
 				  (GREEN_02 & 0x0fff) | 0xa000);
 	
-	terminal = &blitter->blit[1];
+	terminal = blitter->get_blit(1);
 	terminal->terminal_init(0b10001010, 0b00000000, 0x46, GREEN_05,
 				(GREEN_02 & 0x0fff) | 0xa000);
 	
-	cpu_view = &blitter->blit[2];
+	cpu_view = blitter->get_blit(2);
 	cpu_view->terminal_init(0b10001010, 0b00000000, 0x15, GREEN_05,
 				(GREEN_02 & 0x0fff) | 0xa000);
 	
-	disassembly_view = &blitter->blit[3];
+	disassembly_view = blitter->get_blit(3);
 	disassembly_view->terminal_init(0b10001010, 0b00000000, 0x45, GREEN_05,
 					(GREEN_02 & 0x0fff) | 0xa000);
 
-	stack_view = &blitter->blit[4];
+	stack_view = blitter->get_blit(4);
 	stack_view->terminal_init(0b10001010, 0b00000000, 0x34, GREEN_05,
 					(GREEN_02 & 0x0fff) | 0xa000);
 
-	bar_single_height = &blitter->blit[5];
+	bar_single_height = blitter->get_blit(5);
 	bar_single_height->terminal_init(0b00001111, 0b00000000, 0x06, GREEN_05,
 					(GREEN_02 & 0x0fff) | 0xa000);
 
-	bar_double_height = &blitter->blit[6];
+	bar_double_height = blitter->get_blit(6);
 	bar_double_height->terminal_init(0b10001010, 0b00000000, 0x16, GREEN_05,
 					(GREEN_02 & 0x0fff) | 0xa000);
 
-	bar_single_height_small_1 = &blitter->blit[7];
+	bar_single_height_small_1 = blitter->get_blit(7);
 	bar_single_height_small_1->terminal_init(0b10001010, 0b00000000, 0x05, GREEN_05,
 					(GREEN_02 & 0x0fff) | 0xa000);
 
-	bar_single_height_small_2 = &blitter->blit[8];
+	bar_single_height_small_2 = blitter->get_blit(8);
 	bar_single_height_small_2->terminal_init(0b10001010, 0b00000000, 0x05, GREEN_05,
 					(GREEN_02 & 0x0fff) | 0xa000);
 	
-	other_info = &blitter->blit[9];
+	other_info = blitter->get_blit(9);
 	other_info->terminal_init(0b10001010, 0b00000000, 0x34, GREEN_05,
 				  (GREEN_02 & 0x0fff) | 0xa000);
 	
@@ -96,6 +97,7 @@ E64::hud_t::~hud_t()
 	delete cia;
 	delete blitter;
 	delete exceptions;
+	delete scheduler;
 	
 	lua_close(L);
 }
@@ -126,6 +128,7 @@ void E64::hud_t::reset()
 		blitter->blit[5].pixel_data[i] = 0x0000; // bar single height
 	for (int i = 1536; i<2048; i++)
 		blitter->blit[5].pixel_data[i] = GREEN_05; // bar single height
+	blitter->memory_modified(5);
 	
 	bar_double_height->clear();
 	bar_single_height_small_1->clear();
@@ -160,25 +163,25 @@ void E64::hud_t::process_keypress()
 			case ASCII_F1:
 				terminal->deactivate_cursor();
 				if (machine.paused) {
-					machine.run(0);
+					machine.run(true);
 				}
 				terminal->activate_cursor();
 				break;
 			case ASCII_F2:
 				terminal->deactivate_cursor();
 				if (machine.paused) {
-					machine.run(0);
-					machine.run(0);
+					machine.run(true);
+					machine.run(true);
 				}
 				terminal->activate_cursor();
 				break;
 			case ASCII_F3:
 				terminal->deactivate_cursor();
 				if (machine.paused) {
-					machine.run(0);
-					machine.run(0);
-					machine.run(0);
-					machine.run(0);
+					machine.run(true);
+					machine.run(true);
+					machine.run(true);
+					machine.run(true);
 				}
 				terminal->activate_cursor();
 				break;
@@ -232,7 +235,7 @@ void E64::hud_t::update()
 	uint16_t pc = machine.cpu->get_pc();
 	for (int i=0; i<16; i++) {
 		uint16_t old_color = terminal->foreground_color;
-		if (machine.cpu->breakpoint[pc] == true) disassembly_view->foreground_color = AMBER_07;
+		if (machine.cpu->is_breakpoint(pc)) disassembly_view->foreground_color = AMBER_07;
 		if (disassembly_view->get_current_column() != 0)
 			disassembly_view->putchar('\n');
 		int ops = machine.cpu->disassemble(pc, text_buffer);
@@ -296,8 +299,8 @@ void E64::hud_t::update()
 			   "     hud-%c-+ |\n"
 			   "             |\n"
 			   "     xxx-1---+\n",
-			   machine.exceptions->irq_input_pins[vicv.irq_number] ? '1' : '0',
-			   machine.exceptions->irq_input_pins[machine.timer->irq_number] ? '1' : '0',
+			   machine.exceptions->irq_input_pin(vicv.irq_number) ? '1' : '0',
+			   machine.exceptions->irq_input_pin(machine.timer->irq_number) ? '1' : '0',
 			   irq_line ? '1' : '0');
 }
 
@@ -411,14 +414,11 @@ void E64::hud_t::process_command(char *buffer)
 		token1 = strtok(NULL, " ");
 		terminal->putchar('\n');
 		if (token1 == NULL) {
-			uint16_t count = 0;
-			for (int i=0; i< RAM_SIZE; i++) {
-				if (machine.cpu->breakpoint[i]) {
-					terminal->printf("%04x ", i);
-					count++;
-					if ((count % 4) == 0)
-						terminal->putchar('\n');
-				}
+			int count = machine.cpu->get_no_of_breakpoints();
+			for (int i=0; i<count; i++) {
+				terminal->printf("%04x ", machine.cpu->get_breakpoint(i));
+				if (((i + 1) % 4) == 0)
+					terminal->putchar('\n');
 			}
 			if (count == 0) {
 				terminal->puts("no breakpoints");
@@ -427,10 +427,9 @@ void E64::hud_t::process_command(char *buffer)
 			uint32_t temp_32bit;
 			if (hex_string_to_int(token1, &temp_32bit)) {
 				temp_32bit &= (RAM_SIZE - 1);
-				machine.cpu->breakpoint[temp_32bit] =
-					!machine.cpu->breakpoint[temp_32bit];
+				machine.cpu->toggle_breakpoint(temp_32bit);
 				terminal->printf("breakpoint %s at $%04x",
-						machine.cpu->breakpoint[temp_32bit] ? "set" : "cleared",
+						machine.cpu->is_breakpoint(temp_32bit) ? "set" : "cleared",
 						temp_32bit);
 			} else {
 				terminal->puts("error: invalid address\n");
@@ -472,6 +471,20 @@ void E64::hud_t::process_command(char *buffer)
 	} else if (strcmp(token0, "clear") == 0 ) {
 		have_prompt = false;
 		terminal->clear();
+	} else if (strcmp(token0, "engine") == 0) {
+		token1 = strtok(NULL, " ");
+		if (token1 == NULL) {
+			// keep current engine
+		} else if (strcmp(token1, "interpreter") == 0) {
+			machine.cpu->set_engine(CPU_ENGINE_INTERPRETER);
+		} else if (strcmp(token1, "blocks") == 0) {
+			machine.cpu->set_engine(CPU_ENGINE_BLOCKS);
+		} else if (strcmp(token1, "verify") == 0) {
+			machine.cpu->set_engine(CPU_ENGINE_VERIFY);
+		} else {
+			terminal->puts("\nerror: engine must be interpreter, blocks or verify");
+		}
+		terminal->printf("\ncpu engine: %s", machine.cpu->engine_name());
 	} else if (strcmp(token0, "exit") == 0) {
 		have_prompt = false;
 		E64::sdl2_wait_until_enter_released();
@@ -504,6 +517,8 @@ void E64::hud_t::process_command(char *buffer)
 				}
 			}
 		}
+	} else if (strcmp(token0, "pacing") == 0) {
+		terminal->puts(stats.pacing_summary());
 	} else if (strcmp(token0, "reset") == 0) {
 		E64::sdl2_wait_until_enter_released();
 		machine.reset();
@@ -515,6 +530,54 @@ void E64::hud_t::process_command(char *buffer)
 		}
 	} else if (strcmp(token0, "ver") == 0) {
 		terminal->printf("\nE64 (C)%i - version %i.%i (%i)", E64_YEAR, E64_MAJOR_VERSION, E64_MINOR_VERSION, E64_BUILD);
+	} else if (strcmp(token0, "w") == 0) {
+		token1 = strtok(NULL, " ");
+		char *token2 = strtok(NULL, " ");
+		terminal->putchar('\n');
+		if (token1 == NULL) {
+			int count = machine.cpu->get_no_of_watchpoints();
+			for (int i=0; i<count; i++) {
+				uint16_t address = machine.cpu->get_watchpoint_address(i);
+				uint8_t flags = machine.cpu->get_watchpoint(address);
+				terminal->printf("%04x %c%c ", address,
+						 (flags & DEBUG_WATCH_READ) ? 'r' : '-',
+						 (flags & DEBUG_WATCH_WRITE) ? 'w' : '-');
+				if (((i + 1) % 4) == 0)
+					terminal->putchar('\n');
+			}
+			if (count == 0) {
+				terminal->puts("no watchpoints");
+			}
+		} else {
+			uint32_t temp_32bit;
+			if (hex_string_to_int(token1, &temp_32bit)) {
+				temp_32bit &= (RAM_SIZE - 1);
+				/*
+				 * Without r or w, a watchpoint of either kind
+				 * is cleared, and otherwise set for both.
+				 */
+				uint8_t flags = machine.cpu->get_watchpoint(temp_32bit);
+				if (token2 && (strcmp(token2, "r") == 0)) {
+					flags = DEBUG_WATCH_READ;
+				} else if (token2 && (strcmp(token2, "w") == 0)) {
+					flags = DEBUG_WATCH_WRITE;
+				} else if (flags == 0) {
+					flags = DEBUG_WATCH_READ | DEBUG_WATCH_WRITE;
+				}
+				machine.cpu->toggle_watchpoint(temp_32bit, flags);
+				flags = machine.cpu->get_watchpoint(temp_32bit);
+				terminal->printf("watchpoint at $%04x: %s%s%s",
+						 temp_32bit,
+						 flags ? "" : "cleared",
+						 (flags & DEBUG_WATCH_READ) ? "read " : "",
+						 (flags & DEBUG_WATCH_WRITE) ? "write" : "");
+			} else {
+				terminal->puts("error: invalid address\n");
+			}
+		}
+	} else if (strcmp(token0, "wc") == 0 ) {
+		terminal->puts("\nclearing all watchpoints");
+		machine.cpu->clear_watchpoints();
 	} else {
 		terminal->putchar('\n');
 		terminal->printf("error: unknown command '%s'", token0);
@@ -33,6 +33,11 @@ public:
 	void enter_monitor_blit_line(char *buffer);
 	bool hex_string_to_int(const char *temp_string, uint32_t *return_value);
 	
+	/*
+	 * The hud runs its own timer and cia in fixed steps. Their
+	 * deadlines go to a scheduler of its own, which nobody waits on.
+	 */
+	scheduler_t *scheduler;
 	exceptions_ic *exceptions;
 	blitter_ic *blitter;
 	cia_ic *cia;
@@ -9,18 +9,23 @@
 
 E64::machine_t::machine_t()
 {
+	scheduler = new scheduler_t();
+	synced_cycle = 0;
+	
 	mmu = new mmu_ic();
 	exceptions = new exceptions_ic();
 	
-	cpu = new cpu_ic();
+	cpu = new cpu_ic(mmu);
 	cpu->assign_irq_pin(&exceptions->irq_output_pin);
 	cpu->assign_nmi_pin(&exceptions->nmi_output_pin);
+	exceptions->assign_change_flag(cpu->interrupt_change_flag());
+	cpu->assign_deadline(&scheduler->next_deadline);
 	
-	timer = new timer_ic(exceptions);
+	timer = new timer_ic(exceptions, scheduler);
 	
 	blitter = new blitter_ic();
 	sids = new sids_ic();
-	cia = new cia_ic();
+	cia = new cia_ic(scheduler);
 	
 	// init clocks (frequency dividers)
 	system_to_sid = new clocks(SYSTEM_CLOCK_SPEED, SID_CLOCK_SPEED);
@@ -37,14 +42,36 @@ E64::machine_t::~machine_t()
 	delete cpu;
 	delete exceptions;
 	delete mmu;
+	delete scheduler;
 }
 
-bool E64::machine_t::run(uint16_t cycles)
-{	
-	int32_t processed_cycles;
-	bool breakpoint_reached = cpu->run(cycles, &processed_cycles);
-	cia->run(processed_cycles);
-	timer->run(processed_cycles);
+bool E64::machine_t::run(bool single_step)
+{
+	bool breakpoint_reached = cpu->run(single_step);
+	sync();
+	
+	return breakpoint_reached;
+}
+
+void E64::machine_t::sync()
+{
+	uint32_t cycles = cpu->clock_ticks() - synced_cycle;
+	benchmark.lap(BENCH_CPU);
+	
+	if (cycles == 0) return;
+	
+	synced_cycle += cycles;
+	scheduler->current_cycle = synced_cycle;
+	
+	// when paused, vicv keeps being run from the main loop
+	if (!paused) {
+		vicv.run(cycles);
+		benchmark.lap(BENCH_VICV);
+	}
+	cia->run(cycles);
+	benchmark.lap(BENCH_CIA);
+	timer->run(cycles);
+	benchmark.lap(BENCH_TIMER);
 	
 	// run cycles on sound device & start audio if buffer is large enough
 	// some cheating by adjustment of cycles to run depending on current
@@ -52,17 +79,16 @@ bool E64::machine_t::run(uint16_t cycles)
 	unsigned int audio_queue_size = stats.current_audio_queue_size();
 	
 	if (audio_queue_size < 0.9 * AUDIO_BUFFER_SIZE) {
-		sids->run(system_to_sid->clock(1.2 * processed_cycles));
+		sids->run(system_to_sid->clock(1.2 * cycles));
 	} else if (audio_queue_size > 1.1 * AUDIO_BUFFER_SIZE) {
-		sids->run(system_to_sid->clock(0.8 * processed_cycles));
+		sids->run(system_to_sid->clock(0.8 * cycles));
 	} else {
-		sids->run(system_to_sid->clock(processed_cycles));
+		sids->run(system_to_sid->clock(cycles));
 	}
 	
 	if (audio_queue_size > (AUDIO_BUFFER_SIZE/2))
 		E64::sdl2_start_audio();
-	
-	return breakpoint_reached;
+	benchmark.lap(BENCH_SIDS);
 }
 
 void E64::machine_t::reset()
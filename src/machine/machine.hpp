@@ -9,6 +9,7 @@
 #include "cia.hpp"
 #include "clocks.hpp"
 #include "mmu.hpp"
+#include "scheduler.hpp"
 #include "sids.hpp"
 #include "timer.hpp"
 #include "blitter.hpp"
@@ -22,9 +23,13 @@ class machine_t {
 private:
 	clocks *system_to_sid;
 	char machine_help_string[2048];
+	
+	// cpu cycle up to which all devices have been run
+	uint64_t synced_cycle;
 public:
 	bool paused;
 
+	scheduler_t	*scheduler;
 	mmu_ic		*mmu;
 	exceptions_ic	*exceptions;
 	cpu_ic		*cpu;
@@ -36,7 +41,18 @@ public:
 	machine_t();
 	~machine_t();
 
-	bool run(uint16_t no_of_cycles);
+	/*
+	 * Runs the cpu up to the next scheduled event (or one instruction
+	 * when single stepping) and brings all devices up to date. Returns
+	 * true if a breakpoint was reached.
+	 */
+	bool run(bool single_step = false);
+	
+	/*
+	 * Runs all devices up to the current cpu cycle. Besides after each
+	 * run, this is called before I/O writes that depend on timing.
+	 */
+	void sync();
 
 	void reset();
 };
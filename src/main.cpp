@@ -4,6 +4,8 @@
 //  Copyright © 2021 elmerucr. All rights reserved.
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <chrono>
 #include <thread>
 #include "common.hpp"
@@ -11,22 +13,96 @@
 #include "sdl2.hpp"
 #include "vicv.hpp"
 
-#define	CYCLES_PER_STEP	511
+#define	CYCLES_PER_STEP			511
+#define	DEFAULT_BENCHMARK_FRAMES	600
+#define	EVENT_POLL_INTERVAL		2	// ms
 
 // global components
+E64::benchmark_t benchmark;
 E64::host_t	host;
 E64::hud_t	hud;
 E64::stats_t	stats;
 E64::machine_t	machine;
 E64::vicv_ic	vicv;
-bool		app_running;
-std::chrono::time_point<std::chrono::steady_clock> refresh_moment;
+std::atomic<bool> app_running;
 
+static void emulate();
 static void finish_frame();
 
+static void usage(const char *name)
+{
+	printf("usage: %s [-b|--benchmark [frames]] [-e|--engine name] [-t|--threads n] [-h|--help]\n", name);
+	printf("  -b, --benchmark  run headless for a number of frames (default %u)\n"
+	       "                   as fast as possible and report throughput\n",
+	       DEFAULT_BENCHMARK_FRAMES);
+	printf("  -e, --engine     cpu engine: interpreter, blocks (default) or\n"
+	       "                   verify (blocks replayed by the interpreter in\n"
+	       "                   lockstep, differences reported)\n");
+	printf("  -t, --threads    number of threads the blitters draw with\n"
+	       "                   (1 up to %i, default 1)\n", BLITTER_MAX_THREADS);
+}
+
+static bool parse_engine(const char *name, enum E64::cpu_engine *engine)
+{
+	if (strcmp(name, "interpreter") == 0) {
+		*engine = E64::CPU_ENGINE_INTERPRETER;
+	} else if (strcmp(name, "blocks") == 0) {
+		*engine = E64::CPU_ENGINE_BLOCKS;
+	} else if (strcmp(name, "verify") == 0) {
+		*engine = E64::CPU_ENGINE_VERIFY;
+	} else {
+		return false;
+	}
+	return true;
+}
+
 int main(int argc, char **argv)
 {
-	E64::sdl2_init();
+	uint32_t benchmark_frames = 0;
+	enum E64::cpu_engine engine = E64::CPU_ENGINE_BLOCKS;
+	int blitter_threads = 1;
+	
+	for (int i=1; i<argc; i++) {
+		if ((strcmp(argv[i], "-b") == 0) ||
+		    (strcmp(argv[i], "--benchmark") == 0)) {
+			benchmark_frames = DEFAULT_BENCHMARK_FRAMES;
+			if ((i + 1 < argc) && (atoi(argv[i + 1]) > 0))
+				benchmark_frames = atoi(argv[++i]);
+		} else if ((strcmp(argv[i], "-e") == 0) ||
+			   (strcmp(argv[i], "--engine") == 0)) {
+			if ((i + 1 >= argc) || !parse_engine(argv[i + 1], &engine)) {
+				usage(argv[0]);
+				return 1;
+			}
+			i++;
+		} else if ((strcmp(argv[i], "-t") == 0) ||
+			   (strcmp(argv[i], "--threads") == 0)) {
+			if ((i + 1 >= argc) || (atoi(argv[i + 1]) < 1) ||
+			    (atoi(argv[i + 1]) > BLITTER_MAX_THREADS)) {
+				usage(argv[0]);
+				return 1;
+			}
+			blitter_threads = atoi(argv[++i]);
+		} else if ((strcmp(argv[i], "-h") == 0) ||
+			   (strcmp(argv[i], "--help") == 0)) {
+			usage(argv[0]);
+			return 0;
+		} else if (strncmp(argv[i], "-psn_", 5) == 0) {
+			/*
+			 * Process serial number, passed by macOS Finder to
+			 * app bundles. Nothing to do with it.
+			 */
+		} else {
+			/*
+			 * Other arguments may be added by the platform or a
+			 * launcher, don't refuse to start because of them.
+			 */
+			printf("[host] ignoring unknown argument '%s'\n", argv[i]);
+		}
+	}
+	
+	host.init_video(benchmark_frames > 0);
+	if (!host.headless) E64::sdl2_init();
 	
 	app_running = true;
 	
@@ -34,6 +110,9 @@ int main(int argc, char **argv)
 	vicv.irq_number = machine.exceptions->connect_device();
 	
 	hud.reset();
+	machine.cpu->set_engine(engine);
+	machine.blitter->set_threads(blitter_threads);
+	hud.blitter->set_threads(blitter_threads);
 	machine.reset();
 	stats.reset();
 	
@@ -41,36 +120,80 @@ int main(int argc, char **argv)
 	machine.paused = false;
 	hud.paused = true;
 	
-	refresh_moment = std::chrono::steady_clock::now();
+	host.pacer.reset();
+	
+	if (benchmark_frames) benchmark.start(benchmark_frames);
+
+	if (host.headless) {
+		emulate();
+	} else {
+		/*
+		 * The machine runs on a thread of its own, so slow event
+		 * handling can't hold it up. Window system events and
+		 * rendering stay on the main thread, SDL wants it that way.
+		 * Waiting for a frame also spaces out the event polling.
+		 */
+		std::thread emulation(emulate);
+		while (app_running) {
+			if (E64::sdl2_process_events() == E64::QUIT_EVENT)
+				app_running = false;
+			host.video->present_frame(EVENT_POLL_INTERVAL);
+		}
+		host.video->stop_presenting();
+		emulation.join();
+	}
+	
+	if (benchmark.active) benchmark.report();
 
+	if (!host.headless) E64::sdl2_cleanup();
+	return 0;
+}
+
+static void emulate()
+{
 	while (app_running) {
-		vicv.run(CYCLES_PER_STEP);
-		
 		if (machine.paused) {
+			vicv.run(CYCLES_PER_STEP);
+			benchmark.lap(E64::BENCH_VICV);
 			hud.run(CYCLES_PER_STEP);
+			benchmark.lap(E64::BENCH_HUD);
 		} else {
-			if (machine.run(CYCLES_PER_STEP)) {
+			/*
+			 * Runs up to the next scheduled event, which is at
+			 * the latest the end of the current frame.
+			 */
+			if (machine.run()) {
 				// ugly, needs better way...
+				uint16_t address;
+				bool write;
 				hud.flip_modes();
-				hud.terminal->printf("breakpoint reached at $%04x\n",
-						     machine.cpu->get_pc());
+				if (machine.cpu->watchpoint_hit(&address, &write)) {
+					hud.terminal->printf("watchpoint (%s $%04x) reached at $%04x\n",
+							     write ? "write" : "read",
+							     address, machine.cpu->get_pc());
+				} else {
+					hud.terminal->printf("breakpoint reached at $%04x\n",
+							     machine.cpu->get_pc());
+				}
 			}
 		}
 		
 		if (vicv.frame_done())
 			finish_frame();
 	}
-
-	E64::sdl2_cleanup();
-	return 0;
 }
 
 static void finish_frame()
 {
-	if (E64::sdl2_process_events() == E64::QUIT_EVENT) app_running = false;
+	if (host.headless) {
+		if (benchmark.frame_done()) app_running = false;
+	} else {
+		E64::sdl2_process_input();
+	}
 	
 	//machine.blitter->flush();
 	machine.blitter->run(BLITTER_CYCLES_PER_FRAME);
+	benchmark.lap(E64::BENCH_BLITTER);
 	
 	if (!hud.paused) {
 		hud.process_keypress();
@@ -81,36 +204,33 @@ static void finish_frame()
 	hud.blitter->swap_buffers();
 	hud.blitter->clear_framebuffer();
 	hud.redraw();
+	benchmark.lap(E64::BENCH_HUD);
 	hud.blitter->flush();
+	benchmark.lap(E64::BENCH_BLITTER);
 	
-	host.video->clear_frame_buffer();
-	host.video->merge_down_layer(machine.blitter->frontbuffer);
-	host.video->merge_down_layer(hud.blitter->frontbuffer);
+	E64::layer_t layers[2] = {
+		{ machine.blitter->frontbuffer, machine.blitter->frontbuffer_transparent() },
+		{ hud.blitter->frontbuffer, hud.blitter->frontbuffer_transparent() }
+	};
+	
+	// no pacing, no statistics and no screen updates when headless
+	if (host.headless) {
+		host.video->composite(layers, 2);
+		benchmark.lap(E64::BENCH_VIDEO);
+		return;
+	}
 	
 	stats.process_parameters();
 	/*
-	 * If vsync is enabled, the update screen function takes more
-	 * time, i.e. it will return after a few milliseconds, exactly
-	 * when vertical refresh is done. This will avoid tearing.
-	 * Moreover, there's no need then to let the system sleep with a
+	 * If vsync is enabled, handing over the frame waits until the
+	 * main thread has taken the previous one, which happens right
+	 * after a vertical refresh. This paces the machine to the display,
+	 * so there's no need then to let the system sleep with a
 	 * calculated value. But we will still have to do a time
 	 * measurement for estimation of idle time.
 	 */
 	stats.start_idle_time();
-	if (host.video->vsync_disabled()) {
-		refresh_moment +=
-		std::chrono::microseconds(stats.frametime);
-		/*
-			* Check if the next update is in the past,
-			* this can be the result of a debug session.
-			* If so, calculate a new update moment. This will
-			* avoid "playing catch-up" by the virtual machine.
-			*/
-		if (refresh_moment < std::chrono::steady_clock::now())
-			refresh_moment = std::chrono::steady_clock::now() +
-			std::chrono::microseconds(stats.frametime);
-		std::this_thread::sleep_until(refresh_moment);
-	}
-	host.video->update_screen();
+	if (host.video->vsync_disabled()) host.pacer.wait(stats.frametime);
+	host.video->submit_frame(layers, 2);
 	stats.end_idle_time();
 }